@@ -41,7 +41,7 @@ int ledStatus = LOW;
 WiFiServer server(80);
 
 // use a ring buffer to increase speed and reduce memory allocation
-RingBuffer buf(8);
+RingBuffer<8> buf;
 
 void setup() {
   // initialize digital pin LED_BUILTIN as an output.
@@ -89,11 +89,11 @@ void loop() {
 
   if (client) {                               // if you get a client,
     Serial.println("New client");             // print a message out the serial port
-    buf.init();                               // initialize the circular buffer
+    buf.clear();                              // initialize the circular buffer
     while (client.connected()) {              // loop while the client's connected
       if (client.available()) {               // if there's bytes to read from the client,
         char c = client.read();               // read a byte, then
-        buf.push(c);                          // push it to the ring buffer
+        buf.pushOver(c);                      // push it to the ring buffer
 
         // printing the stream to the serial monitor will slow down
         // the receiving of data from the WizFi360 filling the serial buffer
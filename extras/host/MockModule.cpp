@@ -0,0 +1,272 @@
+#include "MockModule.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Time skipped when the host waits for bytes that did not arrive yet
+#define IDLE_STEP_US 100
+
+
+MockModule::MockModule()
+{
+	onLine = respond;
+	onData = respondData;
+	baud = 0;
+	latency = 0;
+	echo = false;
+	passive = false;
+	sendTime = 0;
+	sends = 0;
+	_rxTime = 0;
+	_dataLen = 0;
+	_dataLink = 0;
+	_dataSegment = 0;
+}
+
+// Time of one byte on the serial line (start and stop bits included), in us
+unsigned long MockModule::byteTime()
+{
+	return baud ? 10000000UL/baud : 0;
+}
+
+void MockModule::reply(const std::string& s, unsigned long delayMs)
+{
+	queue(s, hostMicros + latency + delayMs*1000);
+}
+
+void MockModule::later(const std::string& s, unsigned long delayMs)
+{
+	_later.insert(std::make_pair(hostMicros + delayMs*1000, Later{s, -1, 0}));
+}
+
+// Queue bytes coming at the line rate from time, after the bytes already queued
+void MockModule::queue(const std::string& s, unsigned long time)
+{
+	if (not _rx.empty() and _rxTime>time)
+		time = _rxTime;
+
+	for (size_t i=0; i<s.size(); i++)
+	{
+		time += byteTime();
+		_rx.push_back(RxByte{time, s[i]});
+	}
+	_rxTime = time;
+}
+
+void MockModule::expectData(size_t len)
+{
+	_data.clear();
+	_dataLen = len;
+}
+
+void MockModule::receive(int link, const std::string& data, unsigned long delayMs)
+{
+	if (not passive or udpLinks.count(link))
+	{
+		reply("\r\n+IPD," + std::to_string(link) + "," + std::to_string(data.size()) + ",\"1.2.3.4\",80:" + data, delayMs);
+		return;
+	}
+
+	// the module notifies the data, then waits for AT+CIPRECVDATA
+	std::string& kept = pending[link];
+	kept += data;
+	reply("\r\n+IPD," + std::to_string(link) + "," + std::to_string(kept.size()) + ",\"1.2.3.4\",80\r\n", delayMs);
+}
+
+// Queue the notifications which are due
+void MockModule::schedule()
+{
+	while (not _later.empty() and (long)(hostMicros-_later.begin()->first)>=0)
+	{
+		const Later& l = _later.begin()->second;
+		queue(l.s, _later.begin()->first);
+		if (l.ackSegment>0)
+			acked[l.link] = l.ackSegment;
+		_later.erase(_later.begin());
+	}
+}
+
+// Is the next byte due? Otherwise move the clock forward a little
+bool MockModule::ready()
+{
+	schedule();
+	if (not _rx.empty() and (long)(hostMicros-_rx.front().time)>=0)
+		return true;
+
+	// up to the next byte or notification if it is close
+	unsigned long next = hostMicros + IDLE_STEP_US;
+	if (not _rx.empty() and (long)(_rx.front().time-next)<0)
+		next = _rx.front().time;
+	if (not _later.empty() and (long)(_later.begin()->first-next)<0)
+		next = _later.begin()->first;
+	hostMicros = next;
+	return false;
+}
+
+int MockModule::available()
+{
+	schedule();
+
+	// the bytes are queued in time order
+	std::deque<RxByte>::iterator due = std::upper_bound(_rx.begin(), _rx.end(), hostMicros,
+		[](unsigned long now, const RxByte& b) { return (long)(now-b.time)<0; });
+	int n = due-_rx.begin();
+	if (n==0)
+		ready();
+	return n;
+}
+
+int MockModule::read()
+{
+	if (not ready())
+		return -1;
+	uint8_t c = _rx.front().c;
+	_rx.pop_front();
+	received += (char)c;
+	return c;
+}
+
+int MockModule::peek()
+{
+	if (not ready())
+		return -1;
+	return (uint8_t)_rx.front().c;
+}
+
+size_t MockModule::write(uint8_t c)
+{
+	sent += (char)c;
+	hostMicros += byteTime();
+
+	if (_dataLen>0)
+	{
+		_data += (char)c;
+		if (--_dataLen==0)
+		{
+			lastData = _data;
+			sends++;
+			onData(*this, _data);
+		}
+		return 1;
+	}
+
+	_line += (char)c;
+	if (_line.size()>=2 and _line.compare(_line.size()-2, 2, "\r\n")==0)
+	{
+		std::string line = _line.substr(0, _line.size()-2);
+		_line.clear();
+		onLine(*this, line);
+	}
+	return 1;
+}
+
+
+static bool startsWith(const std::string& s, const char* prefix)
+{
+	return s.compare(0, strlen(prefix), prefix)==0;
+}
+
+void MockModule::respond(MockModule& m, const std::string& line)
+{
+	if (line=="AT+RST")
+		m.reply("\r\nOK\r\n\r\n ets Jan  8 2013,rst cause:2\r\nready\r\n", 100);
+	else if (line=="AT+GMR")
+		m.reply("AT version:1.1.1.7(May  4 2021 15:14:59)\r\nSDK version:3.2.0\r\n\r\nOK\r\n");
+	else if (startsWith(line, "AT+CWJAP_CUR="))
+		m.reply("WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n", 300);
+	else if (line=="AT+CWJAP?")
+		m.reply("+CWJAP:\"myssid\",\"aa:bb:cc:dd:ee:ff\",6,-57\r\n\r\nOK\r\n");
+	else if (line=="AT+CIFSR")
+		m.reply("+CIFSR:STAIP,\"192.168.1.5\"\r\n+CIFSR:STAMAC,\"00:08:dc:11:22:33\"\r\n\r\nOK\r\n");
+	else if (line=="AT+CIPSTA?")
+		m.reply("+CIPSTA:ip:\"192.168.1.5\"\r\n+CIPSTA:gateway:\"192.168.1.1\"\r\n+CIPSTA:netmask:\"255.255.255.0\"\r\n\r\nOK\r\n");
+	else if (line=="AT+CWLAP")
+		m.reply("+CWLAP:(3,\"home\",-45)\r\n+CWLAP:(0,\"guest\",-60)\r\n+CWLAP:(4,\"office\",-72)\r\n\r\nOK\r\n", 2000);
+	else if (startsWith(line, "AT+CIPSTART="))
+	{
+		int link = atoi(line.c_str()+12);
+		m.links.insert(link);
+		if (line.find("\"UDP\"")!=std::string::npos)
+			m.udpLinks.insert(link);
+		m.pending.erase(link);
+		m.segments.erase(link);
+		m.acked.erase(link);
+		m.reply(std::to_string(link) + ",CONNECT\r\n\r\nOK\r\n");
+	}
+	else if (startsWith(line, "AT+CIPSEND="))
+	{
+		int link = 0, len = 0;
+		sscanf(line.c_str(), "AT+CIPSEND=%d,%d", &link, &len);
+		m.expectData(len);
+		m._dataLink = link;
+		m._dataSegment = 0;
+		m.reply("\r\nOK\r\n> ");
+	}
+	else if (startsWith(line, "AT+CIPSENDBUF="))
+	{
+		// <segment ID>,<last segment ID sent>
+		int link = 0, len = 0;
+		if (sscanf(line.c_str(), "AT+CIPSENDBUF=%d,%d", &link, &len)!=2)
+		{
+			m.reply("\r\nOK\r\n");
+			return;
+		}
+		m.expectData(len);
+		m._dataLink = link;
+		m._dataSegment = ++m.segments[link];
+		m.reply(std::to_string(m._dataSegment) + "," + std::to_string(m.acked[link]) + "\r\n\r\nOK\r\n> ");
+	}
+	else if (startsWith(line, "AT+CIPRECVMODE="))
+	{
+		m.passive = line[15]=='1';
+		m.reply("\r\nOK\r\n");
+	}
+	else if (startsWith(line, "AT+CIPRECVDATA="))
+	{
+		int link = 0, len = 0;
+		sscanf(line.c_str(), "AT+CIPRECVDATA=%d,%d", &link, &len);
+		if (not m.links.count(link))
+		{
+			m.reply("\r\nERROR\r\n");
+			return;
+		}
+		std::string& kept = m.pending[link];
+		std::string data = kept.substr(0, len);
+		kept.erase(0, data.size());
+		m.reply("+CIPRECVDATA:" + std::to_string(data.size()) + "," + data + "\r\n\r\nOK\r\n");
+	}
+	else if (line=="AT+CIPSTATUS")
+	{
+		std::string r = "STATUS:3\r\n";
+		for (std::set<int>::iterator it=m.links.begin(); it!=m.links.end(); ++it)
+			r += "+CIPSTATUS:" + std::to_string(*it) + ",\"TCP\",\"1.2.3.4\",80,1234,0\r\n";
+		m.reply(r + "\r\nOK\r\n");
+	}
+	else if (startsWith(line, "AT+CIPCLOSE="))
+	{
+		int link = atoi(line.c_str()+12);
+		m.links.erase(link);
+		m.udpLinks.erase(link);
+		m.pending.erase(link);
+		m.reply(std::to_string(link) + ",CLOSED\r\n\r\nOK\r\n");
+	}
+	else
+		m.reply("\r\nOK\r\n");
+}
+
+void MockModule::respondData(MockModule& m, const std::string& data)
+{
+	m.reply("\r\nRecv " + std::to_string(data.size()) + " bytes\r\n");
+	if (m._dataSegment>0)
+	{
+		std::string ok = std::to_string(m._dataLink) + "," + std::to_string(m._dataSegment) + ",SEND OK\r\n";
+		m._later.insert(std::make_pair(hostMicros + m.sendTime*1000, Later{ok, m._dataLink, m._dataSegment}));
+	}
+	else
+	{
+		m.reply("\r\nSEND OK\r\n", m.sendTime);
+	}
+	if (m.echo)
+		m.receive(m._dataLink, data);
+}
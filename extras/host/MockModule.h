@@ -0,0 +1,112 @@
+/*
+ * Stand-in for the serial port of a WizFi360 on the host.
+ *
+ * Each command line written by the driver is passed to onLine, which
+ * answers with reply(). After a CIPSEND prompt, expectData() makes the
+ * next bytes go to onData instead. respond() and respondData() are a
+ * scripted module answering the AT commands used by the driver; a test
+ * replaces onLine or onData to change one answer and falls back to them
+ * for the others.
+ *
+ * By default the module answers at once. baud and latency model the
+ * serial line and the processing time of the module: the bytes written
+ * by the host take the host clock forward, and each reply starts after
+ * the latency and comes at the line rate. With echo set the data sent on
+ * a link comes back as a data packet of the same link.
+ *
+ * Like the module after AT+CIPRECVMODE=1, the data received on a TCP link
+ * is kept until the host asks for it with AT+CIPRECVDATA.
+ *
+ * The data of AT+CIPSEND is acknowledged by SEND OK sendTime after it is
+ * received. The segments of AT+CIPSENDBUF are acknowledged the same way
+ * by a <link ID>,<segment ID>,SEND OK notification, while the module
+ * already accepts the next ones.
+ */
+#ifndef _MOCK_MODULE_H_
+#define _MOCK_MODULE_H_
+
+#include <Arduino.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+
+class MockModule : public Stream
+{
+public:
+	typedef std::function<void(MockModule&, const std::string&)> Handler;
+
+	MockModule();
+
+	// Queue bytes for the host, delayMs after the previous reply
+	void reply(const std::string& s, unsigned long delayMs=0);
+	// Queue bytes sent by the module on its own delayMs from now, after the
+	// replies already started
+	void later(const std::string& s, unsigned long delayMs);
+	// Send the next len bytes written by the host to onData
+	void expectData(size_t len);
+	// Data received on a link, kept in passive mode or sent at once as +IPD
+	void receive(int link, const std::string& data, unsigned long delayMs=0);
+
+	// The scripted module
+	static void respond(MockModule& m, const std::string& line);
+	static void respondData(MockModule& m, const std::string& data);
+
+	Handler onLine;
+	Handler onData;
+
+	unsigned long baud;        // serial line rate, 0 for none
+	unsigned long latency;     // time before each reply, in us
+	bool echo;                 // return the data sent as +IPD
+	bool passive;              // passive receive mode (AT+CIPRECVMODE=1)
+	unsigned long sendTime;    // time to send the data on the network, in ms
+
+	std::string sent;          // every byte written by the host
+	std::string received;      // every byte read by the host
+	std::string lastData;      // payload of the last CIPSEND
+	std::set<int> links;       // open links
+	std::set<int> udpLinks;    // the UDP ones, always in active mode
+	std::map<int, std::string> pending;   // data kept in passive mode
+	unsigned int sends;        // number of CIPSEND payloads received
+	std::map<int, int> segments;   // last AT+CIPSENDBUF segment of each link
+	std::map<int, int> acked;      // last segment acknowledged by SEND OK
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+	virtual size_t write(uint8_t c);
+	using Print::write;
+
+private:
+	struct RxByte
+	{
+		unsigned long time;
+		char c;
+	};
+
+	// notification queued by later()
+	struct Later
+	{
+		std::string s;
+		int link;
+		int ackSegment;    // segment acknowledged when sent, 0 if none
+	};
+
+	void queue(const std::string& s, unsigned long time);
+	void schedule();
+	bool ready();
+	unsigned long byteTime();
+
+	std::deque<RxByte> _rx;
+	std::multimap<unsigned long, Later> _later;
+	unsigned long _rxTime;
+	std::string _line;
+	std::string _data;
+	size_t _dataLen;
+	int _dataLink;
+	int _dataSegment;   // AT+CIPSENDBUF segment of the data expected, 0 for AT+CIPSEND
+};
+
+#endif
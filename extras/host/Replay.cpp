@@ -0,0 +1,178 @@
+#include "Replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Time skipped when the host waits for bytes that are not due yet
+#define IDLE_STEP_US 100
+
+
+Replay::Replay()
+{
+	_next = 0;
+	_txLen = 0;
+	_started = false;
+	_anchorMicros = 0;
+	_anchorTime = 0;
+}
+
+// <time in ms> <'<' or '>'> <bytes in hex>
+bool Replay::load(const std::string& transcript)
+{
+	size_t pos = 0;
+	while (pos<transcript.size())
+	{
+		size_t end = transcript.find('\n', pos);
+		if (end==std::string::npos)
+			end = transcript.size();
+		std::string line = transcript.substr(pos, end-pos);
+		pos = end+1;
+
+		if (not line.empty() and line[line.size()-1]=='\r')
+			line.erase(line.size()-1);
+		if (line.empty())
+			continue;
+
+		Record rec;
+		char dir = 0;
+		char hex[2*0x7F+2] = "";
+		if (sscanf(line.c_str(), "%lu %c %255s", &rec.time, &dir, hex)<2 or (dir!='<' and dir!='>'))
+			return false;
+		size_t len = strlen(hex);
+		if (len%2!=0)
+			return false;
+		rec.tx = dir=='>';
+		for (size_t i=0; i<len; i+=2)
+		{
+			char byte[3] = { hex[i], hex[i+1], 0 };
+			char* endp;
+			rec.bytes += (char)strtoul(byte, &endp, 16);
+			if (*endp!=0)
+				return false;
+		}
+
+		if (rec.tx)
+			expected += rec.bytes;
+		_records.push_back(rec);
+	}
+	return true;
+}
+
+bool Replay::loadFile(const char* path)
+{
+	FILE* f = fopen(path, "r");
+	if (f==NULL)
+		return false;
+	std::string transcript;
+	char buf[256];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f))>0)
+		transcript.append(buf, n);
+	fclose(f);
+	return load(transcript);
+}
+
+bool Replay::done()
+{
+	schedule();
+	return _next==_records.size() and _rx.empty();
+}
+
+unsigned long Replay::duration()
+{
+	if (_records.empty())
+		return 0;
+	return _records.back().time - _records.front().time;
+}
+
+void Replay::anchor(unsigned long now, const Record& rec)
+{
+	_anchorMicros = now;
+	_anchorTime = rec.time;
+}
+
+// Queue the received records which are due. The written ones are passed
+// when the driver has written as many bytes.
+void Replay::schedule()
+{
+	if (not _started)
+	{
+		_started = true;
+		if (not _records.empty())
+			anchor(hostMicros, _records.front());
+	}
+
+	while (_next<_records.size())
+	{
+		const Record& rec = _records[_next];
+		if (rec.tx)
+		{
+			if (sent.size()<_txLen+rec.bytes.size())
+				return;
+			// the writes take as long as in the transcript
+			unsigned long due = _anchorMicros + (rec.time-_anchorTime)*1000;
+			if ((long)(hostMicros-due)<0)
+				hostMicros = due;
+			_txLen += rec.bytes.size();
+			anchor(hostMicros, rec);
+		}
+		else
+		{
+			unsigned long due = _anchorMicros + (rec.time-_anchorTime)*1000;
+			if ((long)(hostMicros-due)<0)
+				return;
+			_rx.insert(_rx.end(), rec.bytes.begin(), rec.bytes.end());
+			anchor(due, rec);
+		}
+		_next++;
+	}
+}
+
+// Is a byte due? Otherwise move the clock forward a little
+bool Replay::ready()
+{
+	schedule();
+	if (not _rx.empty())
+		return true;
+
+	unsigned long next = hostMicros + IDLE_STEP_US;
+	if (_next<_records.size() and not _records[_next].tx)
+	{
+		unsigned long due = _anchorMicros + (_records[_next].time-_anchorTime)*1000;
+		if ((long)(due-next)<0 and (long)(due-hostMicros)>0)
+			next = due;
+	}
+	hostMicros = next;
+	return false;
+}
+
+int Replay::available()
+{
+	schedule();
+	if (_rx.empty())
+		ready();
+	return _rx.size();
+}
+
+int Replay::read()
+{
+	if (not ready())
+		return -1;
+	uint8_t c = _rx.front();
+	_rx.pop_front();
+	return c;
+}
+
+int Replay::peek()
+{
+	if (not ready())
+		return -1;
+	return (uint8_t)_rx.front();
+}
+
+size_t Replay::write(uint8_t c)
+{
+	sent += (char)c;
+	schedule();
+	return 1;
+}
@@ -0,0 +1,75 @@
+/*
+ * Replay of a transcript printed by SerialRecorder::dump(), in place of
+ * the serial port of the module, to run the driver on the host against
+ * the traffic captured on a board.
+ *
+ * The bytes received by the driver in the transcript are served again
+ * with their recorded timing on the host clock: each record is due the
+ * same time after the previous one, or after the driver wrote the bytes
+ * sent before it in the transcript. The writes take the clock forward to
+ * the time of their record, like the serial line did. The bytes written
+ * by the driver are kept in sent, to compare them with the ones of the
+ * transcript.
+ *
+ * Example:
+ *   Replay replay;
+ *   replay.loadFile("capture.txt");
+ *   WiFi.init(&replay);
+ *   ... the calls of the sketch which was recorded
+ *   CHECK(replay.sent==replay.expected);
+ */
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+
+#include <Arduino.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class Replay : public Stream
+{
+public:
+	Replay();
+
+	// Read the lines of dump(), false if one of them is not a record
+	bool load(const std::string& transcript);
+	bool loadFile(const char* path);
+
+	// All the records replayed and the bytes received read
+	bool done();
+	// Time of the last record, in ms from the first one
+	unsigned long duration();
+
+	std::string sent;          // every byte written by the host
+	std::string expected;      // the bytes written in the transcript
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+	virtual size_t write(uint8_t c);
+	using Print::write;
+
+private:
+	struct Record
+	{
+		unsigned long time;    // ms
+		bool tx;
+		std::string bytes;
+	};
+
+	void schedule();
+	bool ready();
+	void anchor(unsigned long now, const Record& rec);
+
+	std::vector<Record> _records;
+	size_t _next;              // next record to replay
+	size_t _txLen;             // bytes of the transcript written up to the next record
+	std::deque<char> _rx;      // bytes of the records due, not read yet
+
+	bool _started;
+	unsigned long _anchorMicros;   // host time of the last record replayed
+	unsigned long _anchorTime;     // and its time in the transcript
+};
+
+#endif
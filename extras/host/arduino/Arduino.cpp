@@ -0,0 +1,121 @@
+#include "Arduino.h"
+
+unsigned long hostMicros = 0;
+
+HardwareSerial Serial;
+
+unsigned long millis()
+{
+	return ++hostMicros / 1000;
+}
+
+unsigned long micros()
+{
+	return ++hostMicros;
+}
+
+void delay(unsigned long ms)
+{
+	hostMicros += ms*1000;
+}
+
+void yield()
+{
+}
+
+
+int Stream::timedRead()
+{
+	unsigned long start = millis();
+	do {
+		int c = read();
+		if (c>=0)
+			return c;
+	} while (millis()-start < _timeout);
+	return -1;
+}
+
+int Stream::timedPeek()
+{
+	unsigned long start = millis();
+	do {
+		int c = peek();
+		if (c>=0)
+			return c;
+	} while (millis()-start < _timeout);
+	return -1;
+}
+
+bool Stream::find(const char* target)
+{
+	size_t len = strlen(target);
+	size_t index = 0;
+	if (len==0)
+		return true;
+
+	int c;
+	while ((c = timedRead()) >= 0)
+	{
+		if (c==target[index])
+		{
+			if (++index==len)
+				return true;
+		}
+		else
+			index = (c==target[0]) ? 1 : 0;
+	}
+	return false;
+}
+
+long Stream::parseInt()
+{
+	int c;
+	while ((c = timedPeek()) >= 0 and c!='-' and not isDigit(c))
+		read();
+	if (c<0)
+		return 0;
+
+	bool negative = false;
+	if (c=='-')
+	{
+		negative = true;
+		read();
+	}
+
+	long value = 0;
+	while ((c = timedPeek()) >= 0 and isDigit(c))
+	{
+		value = value*10 + c-'0';
+		read();
+	}
+	return negative ? -value : value;
+}
+
+size_t Stream::readBytes(uint8_t* buf, size_t length)
+{
+	size_t count = 0;
+	while (count<length)
+	{
+		int c = timedRead();
+		if (c<0)
+			break;
+		buf[count++] = c;
+	}
+	return count;
+}
+
+
+bool IPAddress::fromString(const char* address)
+{
+	unsigned int b[4];
+	char end;
+	if (sscanf(address, "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &end)!=4)
+		return false;
+	for (int i=0; i<4; i++)
+	{
+		if (b[i]>255)
+			return false;
+		_address[i] = b[i];
+	}
+	return true;
+}
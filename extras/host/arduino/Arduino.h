@@ -0,0 +1,68 @@
+/*
+ * Minimal Arduino API for building the library on a Linux host.
+ * Only what the library and its examples use is provided.
+ */
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "avr/pgmspace.h"
+#include "Print.h"
+#include "Stream.h"
+#include "IPAddress.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+/*
+ * The host clock is simulated. It only moves forward by one microsecond
+ * on each call to millis() or micros(), in delay(), and when a test or
+ * the module stand-in advances it, so timeouts expire deterministically.
+ */
+extern unsigned long hostMicros;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+inline bool isDigit(int c) { return c>='0' and c<='9'; }
+
+typedef uint16_t word;
+inline word makeWord(uint16_t w) { return w; }
+inline word makeWord(uint8_t h, uint8_t l) { return (h << 8) | l; }
+#define word(...) makeWord(__VA_ARGS__)
+
+// The pins, for the examples. Nothing is connected to them on the host.
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define LED_BUILTIN 13
+#define A0 14
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return LOW; }
+inline int analogRead(uint8_t) { return 0; }
+
+class HardwareSerial : public Stream
+{
+public:
+	void begin(unsigned long) {}
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+	virtual size_t write(uint8_t c) { return fputc(c, stdout)==EOF ? 0 : 1; }
+	using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _HOST_IPADDRESS_H_
+#define _HOST_IPADDRESS_H_
+
+#include <stdint.h>
+
+#include "Print.h"
+
+class IPAddress : public Printable
+{
+public:
+	IPAddress() { set(0, 0, 0, 0); }
+	IPAddress(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) { set(b0, b1, b2, b3); }
+	IPAddress(const uint8_t* address) { set(address[0], address[1], address[2], address[3]); }
+
+	bool fromString(const char* address);
+
+	IPAddress& operator=(const uint8_t* address) { set(address[0], address[1], address[2], address[3]); return *this; }
+	bool operator==(const IPAddress& other) const { return _address[0]==other._address[0] and _address[1]==other._address[1] and _address[2]==other._address[2] and _address[3]==other._address[3]; }
+	uint8_t operator[](int index) const { return _address[index]; }
+	uint8_t& operator[](int index) { return _address[index]; }
+
+	virtual size_t printTo(Print& p) const
+	{
+		size_t n = 0;
+		for (int i=0; i<4; i++)
+		{
+			if (i>0)
+				n += p.print('.');
+			n += p.print(_address[i], DEC);
+		}
+		return n;
+	}
+
+private:
+	void set(uint8_t b0, uint8_t b1, uint8_t b2, uint8_t b3) { _address[0] = b0; _address[1] = b1; _address[2] = b2; _address[3] = b3; }
+
+	uint8_t _address[4];
+};
+
+#endif
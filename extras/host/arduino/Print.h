@@ -0,0 +1,85 @@
+#ifndef _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "avr/pgmspace.h"
+#include "Printable.h"
+
+#define DEC 10
+#define HEX 16
+
+class Print
+{
+public:
+	Print() : _writeError(0) {}
+	virtual ~Print() {}
+
+	virtual size_t write(uint8_t) = 0;
+	virtual size_t write(const uint8_t* buf, size_t size)
+	{
+		size_t n = 0;
+		while (size--)
+			n += write(*buf++);
+		return n;
+	}
+	size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+	size_t write(const char* buf, size_t size) { return write((const uint8_t*)buf, size); }
+	virtual void flush() {}
+
+	int getWriteError() { return _writeError; }
+	void clearWriteError() { _writeError = 0; }
+
+	size_t print(const __FlashStringHelper* s) { return write((const char*)s); }
+	size_t print(const char* s) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char n, int base=DEC) { return print((unsigned long)n, base); }
+	size_t print(int n, int base=DEC) { return print((long)n, base); }
+	size_t print(unsigned int n, int base=DEC) { return print((unsigned long)n, base); }
+	size_t print(long n, int base=DEC)
+	{
+		if (base==DEC and n<0)
+			return print('-') + printNumber(-(unsigned long)n, DEC);
+		return printNumber(n, base);
+	}
+	size_t print(unsigned long n, int base=DEC) { return printNumber(n, base); }
+	size_t print(double n, int digits=2) { return printf_("%.*f", digits, n); }
+	size_t print(const Printable& x) { return x.printTo(*this); }
+
+	size_t println() { return write("\r\n"); }
+	template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+	template<typename T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+
+protected:
+	void setWriteError(int err=1) { _writeError = err; }
+
+private:
+	// as in the Arduino core
+	size_t printNumber(unsigned long n, int base)
+	{
+		char buf[8*sizeof(long)+1];
+		char* str = &buf[sizeof(buf)-1];
+		*str = '\0';
+		do
+		{
+			char c = n%base;
+			n /= base;
+			*--str = c<10 ? c+'0' : c+'A'-10;
+		} while (n);
+		return write(str);
+	}
+
+	template<typename... Args> size_t printf_(const char* fmt, Args... args)
+	{
+		char buf[32];
+		snprintf(buf, sizeof(buf), fmt, args...);
+		return write(buf);
+	}
+
+	int _writeError;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _HOST_PRINTABLE_H_
+#define _HOST_PRINTABLE_H_
+
+#include <stddef.h>
+
+class Print;
+
+// Class which can print itself, such as IPAddress
+class Printable
+{
+public:
+	virtual ~Printable() {}
+	virtual size_t printTo(Print& p) const = 0;
+};
+
+#endif
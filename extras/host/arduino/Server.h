@@ -0,0 +1,12 @@
+#ifndef _HOST_SERVER_H_
+#define _HOST_SERVER_H_
+
+#include "Print.h"
+
+class Server : public Print
+{
+public:
+	virtual void begin() = 0;
+};
+
+#endif
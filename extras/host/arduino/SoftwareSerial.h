@@ -0,0 +1,20 @@
+#ifndef _HOST_SOFTWARESERIAL_H_
+#define _HOST_SOFTWARESERIAL_H_
+
+#include "Arduino.h"
+
+// Serial port on two pins, used by the examples for the module. Nothing
+// is connected to it on the host.
+class SoftwareSerial : public Stream
+{
+public:
+	SoftwareSerial(uint8_t rxPin, uint8_t txPin) {}
+	void begin(long) {}
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+	virtual size_t write(uint8_t) { return 1; }
+	using Print::write;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef _HOST_STREAM_H_
+#define _HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+	Stream() : _timeout(1000) {}
+
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long timeout) { _timeout = timeout; }
+	bool find(const char* target);
+	long parseInt();
+	size_t readBytes(uint8_t* buf, size_t length);
+	size_t readBytes(char* buf, size_t length) { return readBytes((uint8_t*)buf, length); }
+
+protected:
+	int timedRead();
+	int timedPeek();
+
+	unsigned long _timeout;
+};
+
+#endif
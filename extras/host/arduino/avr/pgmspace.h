@@ -0,0 +1,25 @@
+#ifndef _HOST_PGMSPACE_H_
+#define _HOST_PGMSPACE_H_
+
+#include <stdio.h>
+#include <string.h>
+
+// On the host the flash strings are plain strings
+#define PROGMEM
+#define PSTR(s) (s)
+typedef const char* PGM_P;
+
+#define pgm_read_byte(p) (*(const unsigned char*)(p))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define memcpy_P memcpy
+#define sprintf_P sprintf
+#define vsnprintf_P vsnprintf
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+
+#endif
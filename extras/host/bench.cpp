@@ -0,0 +1,222 @@
+/*
+ * Throughput and latency of the library against the scripted module,
+ * with the serial line and the processing time of the module modelled.
+ * The times are those of the simulated clock, so the results only depend
+ * on the library and the model.
+ *
+ *   bench [baud [latency in us]]
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+
+#include <stdlib.h>
+
+static MockModule module;
+
+static double seconds(unsigned long start)
+{
+	return (hostMicros-start)/1e6;
+}
+
+static void benchSend(size_t total, size_t writeSize)
+{
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+
+	std::string buf(writeSize, 'x');
+	unsigned int sends = module.sends;
+	size_t sent = 0;
+	unsigned long start = hostMicros;
+	while (sent<total)
+	{
+		client.write((const uint8_t*)buf.data(), buf.size());
+		sent += buf.size();
+	}
+	client.flush();
+	double t = seconds(start);
+
+	printf("send    %6zu B writes  %8.1f kB/s  %5u CIPSEND\n", writeSize, sent/t/1000, module.sends-sends);
+	client.stop();
+}
+
+// Large writes to a module which takes sendTime ms to deliver each segment,
+// waiting for each SEND OK (window 0) or with segments in flight
+static void benchWindow(int window, unsigned long sendTime)
+{
+	WiFi.setSendWindow(window);
+	module.sendTime = sendTime;
+
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+
+	const size_t total = 32768;
+	std::string buf(1460, 'w');
+	size_t sent = 0;
+	unsigned long start = hostMicros;
+	while (sent<total)
+	{
+		client.write((const uint8_t*)buf.data(), buf.size());
+		sent += buf.size();
+	}
+	double t = seconds(start);
+	// the segments still in flight are waited for by stop
+	client.stop();
+	double tAcked = seconds(start);
+
+	printf("send    window %d         %8.1f kB/s  %8.1f kB/s acked (SEND OK after %lu ms)\n", window, sent/t/1000, sent/tAcked/1000, sendTime);
+	module.sendTime = 0;
+	WiFi.setSendWindow(0);
+}
+
+static void benchReceive(size_t total, size_t packetSize)
+{
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+	int link = *module.links.begin();
+
+	std::string packet(packetSize, 'y');
+	for (size_t n=0; n<total; n+=packetSize)
+		module.receive(link, packet);
+
+	uint8_t buf[256];
+	size_t received = 0;
+	unsigned long start = hostMicros;
+	while (received<total)
+	{
+		int n = client.read(buf, sizeof(buf));
+		if (n>0)
+			received += n;
+	}
+	double t = seconds(start);
+
+	printf("receive %6zu B packets %8.1f kB/s\n", packetSize, received/t/1000);
+	client.stop();
+}
+
+// Transparent transmission: after AT+CIPSEND the serial line only carries
+// the data of the connection
+static bool passThrough;
+
+static void transparentModule(MockModule& m, const std::string& line)
+{
+	if (passThrough)
+		return;
+	// the escape sequence is not followed by a line end
+	std::string cmd = line.compare(0, 3, "+++")==0 ? line.substr(3) : line;
+	if (cmd=="AT+CIPSEND")
+	{
+		passThrough = true;
+		m.reply("\r\nOK\r\n\r\n>");
+	}
+	else if (cmd.compare(0, 17, "AT+CIPSTART=\"TCP\"")==0)
+		m.reply("CONNECT\r\n\r\nOK\r\n");
+	else
+		MockModule::respond(m, cmd);
+}
+
+// Bytes on the serial line, both ways, to send then receive total bytes in
+// 1460 byte blocks, framed with AT+CIPSEND and +IPD or in transparent mode
+static void benchWire(size_t total, bool transparent)
+{
+	WiFiClient client;
+	if (transparent)
+	{
+		module.onLine = transparentModule;
+		client.connectTransparent("1.2.3.4", 80);
+	}
+	else
+		client.connect("1.2.3.4", 80);
+	int link = *module.links.begin();
+
+	const size_t blockSize = 1460;
+	std::string block(blockSize-2, 'b');
+	block += "\r\n";
+	uint8_t buf[256];
+
+	for (int dir=0; dir<2; dir++)
+	{
+		size_t wire = module.sent.size()+module.received.size();
+		size_t bytes = 0;
+		unsigned long start = hostMicros;
+		for (; bytes<total; bytes+=blockSize)
+		{
+			if (dir==0)
+			{
+				client.write((const uint8_t*)block.data(), block.size());
+				continue;
+			}
+			if (transparent)
+				module.reply(block);
+			else
+				module.receive(link, block);
+			for (size_t left=blockSize; left>0; )
+			{
+				int r = client.read(buf, sizeof(buf));
+				if (r>0)
+					left -= r;
+			}
+		}
+		client.flush();
+		double t = seconds(start);
+		wire = module.sent.size()+module.received.size()-wire;
+
+		printf("%-7s %-11s  %8.1f kB/s  %8zu B on the wire, %5.2f%% overhead\n", dir==0 ? "send" : "receive",
+			transparent ? "transparent" : "framed", bytes/t/1000, wire, (double)(wire-bytes)*100/bytes);
+	}
+
+	passThrough = false;
+	client.stop();
+	module.onLine = MockModule::respond;
+}
+
+static void benchRoundTrip(int count, size_t size)
+{
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+
+	module.echo = true;
+	std::string buf(size, 'z');
+	uint8_t in[256];
+	unsigned long start = hostMicros;
+	for (int i=0; i<count; i++)
+	{
+		client.write((const uint8_t*)buf.data(), buf.size());
+		client.flush();
+		size_t n = 0;
+		while (n<size)
+		{
+			int r = client.read(in, sizeof(in));
+			if (r>0)
+				n += r;
+		}
+	}
+	double t = seconds(start);
+	module.echo = false;
+
+	printf("echo    %6zu B         %8.2f ms per round trip\n", size, t*1000/count);
+	client.stop();
+}
+
+int main(int argc, char** argv)
+{
+	module.baud = argc>1 ? strtoul(argv[1], NULL, 10) : 115200;
+	module.latency = argc>2 ? strtoul(argv[2], NULL, 10) : 1000;
+
+	WiFi.init(&module);
+
+	printf("%lu baud, module latency %lu us\n", module.baud, module.latency);
+	benchSend(32768, 16);
+	benchSend(32768, 256);
+	benchSend(32768, 4096);
+	benchWindow(0, 20);
+	benchWindow(4, 20);
+	benchReceive(32768, 256);
+	benchReceive(32768, 1460);
+	benchWire(1<<20, false);
+	benchWire(1<<20, true);
+	benchRoundTrip(100, 32);
+	benchRoundTrip(100, 200);
+
+	return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * The implementations replaced in the library, kept to compare them with
+ * the new ones in microbench.cpp. They are copied from the original code
+ * with only the changes needed to build them here.
+ */
+#ifndef _HOST_LEGACY_H_
+#define _HOST_LEGACY_H_
+
+#include <Arduino.h>
+
+#include <stdarg.h>
+
+
+// RingBuffer of the original driver: allocated storage, compare-and-branch
+// wrap and a byte by byte endsWith
+class LegacyRingBuffer
+{
+public:
+	LegacyRingBuffer(unsigned int size)
+	{
+		_size = size;
+		// add one char to terminate the string
+		ringBuf = new char[size+1];
+		ringBufEnd = &ringBuf[size];
+		init();
+	}
+
+	void reset()
+	{
+		ringBufP = ringBuf;
+	}
+
+	void init()
+	{
+		ringBufP = ringBuf;
+		memset(ringBuf, 0, _size+1);
+	}
+
+	void push(char c)
+	{
+		*ringBufP = c;
+		ringBufP++;
+		if (ringBufP>=ringBufEnd)
+			ringBufP = ringBuf;
+	}
+
+	bool endsWith(const char* str)
+	{
+		int findStrLen = strlen(str);
+
+		// b is the start position into the ring buffer
+		char* b = ringBufP-findStrLen;
+		if(b < ringBuf)
+			b = b + _size;
+
+		char *p1 = (char*)&str[0];
+		char *p2 = p1 + findStrLen;
+
+		for(char *p=p1; p<p2; p++)
+		{
+			if(*p != *b)
+				return false;
+
+			b++;
+			if (b == ringBufEnd)
+				b=ringBuf;
+		}
+
+		return true;
+	}
+
+private:
+	unsigned int _size;
+	char* ringBuf;
+	char* ringBufEnd;
+	char* ringBufP;
+};
+
+
+// Response tags of the original readUntil
+static const char* LEGACY_TAGS[] =
+{
+	"\r\nOK\r\n",
+	"\r\nERROR\r\n",
+	"\r\nFAIL\r\n",
+	"\r\nSEND OK\r\n",
+	" CONNECT\r\n"
+};
+
+#define LEGACY_NUM_TAGS 5
+
+// Tag search of the original readUntil for one character: the caller's tag,
+// then each response tag compared backwards from the last character
+inline int legacyMatch(LegacyRingBuffer& ringBuf, char c, const char* tag, bool findTags)
+{
+	int ret = -1;
+
+	ringBuf.push(c);
+
+	if (tag!=NULL)
+	{
+		if (ringBuf.endsWith(tag))
+		{
+			ret = LEGACY_NUM_TAGS;
+		}
+	}
+	if(findTags)
+	{
+		for(int i=0; i<LEGACY_NUM_TAGS; i++)
+		{
+			if (ringBuf.endsWith(LEGACY_TAGS[i]))
+			{
+				ret = i;
+				break;
+			}
+		}
+	}
+	return ret;
+}
+
+
+// State of the data packet in progress of the original driver
+struct LegacyRx
+{
+	uint8_t _connId;
+	uint16_t _bufPos;
+	uint8_t _remoteIp[4];
+	uint16_t _remotePort;
+};
+
+// Header parsing of the original availData
+inline uint16_t legacyAvailData(Stream* wizfi360Serial, LegacyRx& rx, uint8_t connId)
+{
+	// if there is data in the buffer
+	if (rx._bufPos>0)
+	{
+		if (rx._connId==connId)
+			return rx._bufPos;
+		else if (rx._connId==0)
+			return rx._bufPos;
+	}
+
+
+    int bytes = wizfi360Serial->available();
+
+	if (bytes)
+	{
+		if (wizfi360Serial->find((char *)"+IPD,"))
+		{
+			// format is : +IPD,<ID>,<len>[,<remote IP>,<remote port>]:<data>
+
+			rx._connId = wizfi360Serial->parseInt();    // <ID>
+			wizfi360Serial->read();                  // ,
+			rx._bufPos = wizfi360Serial->parseInt();    // <len>
+			wizfi360Serial->read();                  // "
+			rx._remoteIp[0] = wizfi360Serial->parseInt();    // <remote IP>
+			wizfi360Serial->read();                  // .
+			rx._remoteIp[1] = wizfi360Serial->parseInt();
+			wizfi360Serial->read();                  // .
+			rx._remoteIp[2] = wizfi360Serial->parseInt();
+			wizfi360Serial->read();                  // .
+			rx._remoteIp[3] = wizfi360Serial->parseInt();
+			wizfi360Serial->read();                  // "
+			wizfi360Serial->read();                  // ,
+			rx._remotePort = wizfi360Serial->parseInt();     // <remote port>
+
+			wizfi360Serial->read();                  // :
+
+			if(rx._connId==connId || connId==0)
+				return rx._bufPos;
+		}
+	}
+	return 0;
+}
+
+// Byte reads of the original getDataBuf, each one with its own timeout
+inline int legacyTimedRead(Stream* wizfi360Serial)
+{
+  unsigned int _timeout = 1000;
+  int c;
+  long _startMillis = millis();
+  do
+  {
+    c = wizfi360Serial->read();
+    if (c >= 0) return c;
+  } while(millis() - _startMillis < _timeout);
+
+  return -1; // -1 indicates timeout
+}
+
+// Original getDataBuf
+inline int legacyGetDataBuf(Stream* wizfi360Serial, LegacyRx& rx, uint8_t connId, uint8_t *buf, uint16_t bufSize)
+{
+	if (connId!=rx._connId)
+		return false;
+
+	if(rx._bufPos<bufSize)
+		bufSize = rx._bufPos;
+
+	for(uint16_t i=0; i<bufSize; i++)
+	{
+		int c = legacyTimedRead(wizfi360Serial);
+		//LOGDEBUG(c);
+		if(c==-1)
+			return -1;
+
+		buf[i] = (char)c;
+		rx._bufPos--;
+	}
+
+	return bufSize;
+}
+
+
+#define LEGACY_CMD_BUFFER_SIZE 200
+
+// Command output of the original sendCmd: the arguments are formatted in a
+// buffer on the stack, then the buffer is printed. The wizfi360EmptyBuf
+// before and the readUntil after are left out.
+inline int legacySendCmd(Print* wizfi360Serial, const __FlashStringHelper* cmd, int timeout, ...)
+{
+	char cmdBuf[LEGACY_CMD_BUFFER_SIZE];
+
+	va_list args;
+	va_start (args, timeout);
+	vsnprintf_P (cmdBuf, LEGACY_CMD_BUFFER_SIZE, (char*)cmd, args);
+	va_end (args);
+
+	return wizfi360Serial->println(cmdBuf);
+}
+
+#endif
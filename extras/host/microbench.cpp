@@ -0,0 +1,306 @@
+/*
+ * CPU time of the hot paths of the driver, compared with the code they
+ * replaced (see legacy.h). Unlike bench.cpp the times are those of the
+ * host CPU: only the ratios between the old and new code are meaningful.
+ *
+ *   microbench [repeat]
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "legacy.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+#if defined(__x86_64__) or defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+extern const char* WIZFI360TAGS[];
+
+static MockModule module;
+
+static int repeat;
+
+// defeats the removal of the results not used
+static volatile long sink;
+
+
+class CpuTimer
+{
+public:
+	CpuTimer()
+	{
+		_start = std::chrono::steady_clock::now();
+		_tsc = tsc();
+	}
+
+	void report(const char* name, size_t bytes)
+	{
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now()-_start).count();
+		printf("%-34s %8.1f MB/s %7.2f ns/B", name, bytes/ns*1000, ns/bytes);
+		if (HAVE_TSC)
+			printf(" %7.1f cycles/B", (double)(tsc()-_tsc)/bytes);
+		printf("\n");
+	}
+
+private:
+	static unsigned long long tsc()
+	{
+#if HAVE_TSC
+		return __rdtsc();
+#else
+		return 0;
+#endif
+	}
+
+	std::chrono::steady_clock::time_point _start;
+	unsigned long long _tsc;
+};
+
+
+// AT traffic of a session with the scripted module, as read by the driver
+static std::string recordSession()
+{
+	module.received.clear();
+
+	WiFi.init(&module);
+	WiFi.begin("myssid", "password");
+
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+	int link = *module.links.begin();
+	for (int i=0; i<20; i++)
+	{
+		client.print(F("GET /data?page="));
+		client.println(i);
+		client.println();
+
+		std::string body = "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 64\r\n\r\n" + std::string(64, 'a'+i%26);
+		module.reply("\r\n+IPD," + std::to_string(link) + "," + std::to_string(body.size()) + ",\"1.2.3.4\",80:" + body);
+		while (client.available())
+			client.read();
+		WiFi.status();
+	}
+	client.stop();
+
+	return module.received;
+}
+
+// Response tag search of readUntil: the original backwards compares against
+// the multi-pattern automaton
+static void benchTagMatch(const std::string& transcript)
+{
+	const char* tag = "+CWJAP:\"";
+	size_t bytes = transcript.size()*repeat;
+	long found = 0;
+
+	{
+		LegacyRingBuffer ringBuf(32);
+		CpuTimer timer;
+		for (int r=0; r<repeat; r++)
+		{
+			for (size_t i=0; i<transcript.size(); i++)
+				found += legacyMatch(ringBuf, transcript[i], tag, true)>=0;
+		}
+		timer.report("tags: endsWith loop", bytes);
+	}
+
+	{
+		RingBuffer<32> ringBuf;
+		TagMatcher<TAG_MATCHER_NODES> respTags;
+		TagMatcher<TAG_MAX_LENGTH+1> userTag;
+		respTags.build(WIZFI360TAGS, 6);
+		userTag.build(tag);
+		CpuTimer timer;
+		for (int r=0; r<repeat; r++)
+		{
+			for (size_t i=0; i<transcript.size(); i++)
+			{
+				char c = transcript[i];
+				ringBuf.pushOver(c);
+				bool user = userTag.step(c)>=0;
+				int idx = respTags.step(c);
+				found -= user or (idx>=0 and idx<LEGACY_NUM_TAGS);
+			}
+		}
+		timer.report("tags: automaton", bytes);
+	}
+
+	// the same tags are found by both
+	if (found!=0)
+		printf("tags: different matches (%ld)\n", found);
+	sink = found;
+}
+
+// Reads of the data packets in blocks, as WiFiClient::read(buf, size) does
+// them: the original header parsing and byte by byte timedRead loop against
+// the +IPD parser, the receive buffers and getDataBuf. Both read from the
+// scripted module.
+static void benchRead()
+{
+	const size_t total = 1<<20;
+	const size_t packetSize = 1460;
+
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+	int link = *module.links.begin();
+	std::string packet = "\r\n+IPD," + std::to_string(link) + "," + std::to_string(packetSize) + ",\"1.2.3.4\",80:" + std::string(packetSize, 'r');
+
+	uint8_t buf[256];
+	long received = 0;
+
+	{
+		LegacyRx rx = LegacyRx();
+		CpuTimer timer;
+		for (size_t n=0; n<total; n+=packetSize)
+		{
+			module.reply(packet);
+			while (legacyAvailData(&module, rx, link)>0)
+				received += legacyGetDataBuf(&module, rx, link, buf, sizeof(buf));
+		}
+		timer.report("read: timedRead per byte", received);
+	}
+
+	received = 0;
+	{
+		CpuTimer timer;
+		for (size_t n=0; n<total; n+=packetSize)
+		{
+			module.reply(packet);
+			for (size_t left=packetSize; left>0; )
+			{
+				int r = client.read(buf, sizeof(buf));
+				if (r>0)
+					left -= r;
+				received += r;
+			}
+		}
+		timer.report("read: getDataBuf blocks", received);
+	}
+
+	client.stop();
+	module.received.clear();
+	sink = received;
+}
+
+// Request parsing of the WebServer examples: each byte pushed in an 8 byte
+// ring buffer, then compared with the end of the header and the commands
+static void benchRingBuffer()
+{
+	const std::string request = "GET /H HTTP/1.1\r\nHost: 192.168.1.5\r\nUser-Agent: curl/7.68.0\r\nAccept: */*\r\n\r\n";
+	size_t bytes = request.size()*repeat*10;
+	long found = 0;
+
+	{
+		LegacyRingBuffer buf(8);
+		CpuTimer timer;
+		for (int r=0; r<repeat*10; r++)
+		{
+			buf.init();
+			for (size_t i=0; i<request.size(); i++)
+			{
+				buf.push(request[i]);
+				found += buf.endsWith("\r\n\r\n") + buf.endsWith("GET /H") + buf.endsWith("GET /L");
+			}
+		}
+		timer.report("ringbuf: allocated, branch wrap", bytes);
+	}
+
+	{
+		RingBuffer<8> buf;
+		CpuTimer timer;
+		for (int r=0; r<repeat*10; r++)
+		{
+			buf.clear();
+			for (size_t i=0; i<request.size(); i++)
+			{
+				buf.pushOver(request[i]);
+				found -= buf.endsWith("\r\n\r\n") + buf.endsWith("GET /H") + buf.endsWith("GET /L");
+			}
+		}
+		timer.report("ringbuf: RingBuffer<8> pushOver", bytes);
+	}
+
+	// the same ends are found by both
+	if (found!=0)
+		printf("ringbuf: different matches (%ld)\n", found);
+	sink = found;
+}
+
+// Counts the bytes of the commands without storing them
+class NullPrint : public Print
+{
+public:
+	size_t write(uint8_t) { return 1; }
+	size_t write(const uint8_t* buf, size_t size) { return size; }
+};
+
+// Commands as sendCmd writes them: through the original vsnprintf_P into a
+// 200 byte buffer against the arguments streamed by CmdArgs, with the
+// untyped printArgs call of writeCommand
+template<typename... Args>
+static size_t printCmd(Print* out, const __FlashStringHelper* cmd, Args... args)
+{
+	CmdArgs<Args...> cmdArgs(args...);
+	size_t (*printArgs)(Print*, const void*) = printCmdArgs<Args...>;
+	size_t n = out->print(cmd);
+	n += printArgs(out, &cmdArgs);
+	return n + out->println();
+}
+
+static void benchCmd()
+{
+	NullPrint out;
+	const char* ssid = "myssid";
+	const char* pwd = "password";
+	size_t bytes = 0;
+
+	{
+		CpuTimer timer;
+		for (int r=0; r<repeat*10; r++)
+		{
+			bytes += legacySendCmd(&out, F("AT+CWJAP_CUR=\"%s\",\"%s\""), 20000, ssid, pwd);
+			bytes += legacySendCmd(&out, F("AT+CIPSTART=%d,\"%s\",\"%s\",%u"), 10000, 1, "TCP", "192.168.1.10", 8080);
+			bytes += legacySendCmd(&out, F("AT+CIPSEND=%d,%u"), 1000, 1, 1460);
+		}
+		timer.report("cmd: vsnprintf_P buffer", bytes);
+	}
+
+	long diff = bytes;
+	bytes = 0;
+	{
+		CpuTimer timer;
+		for (int r=0; r<repeat*10; r++)
+		{
+			bytes += printCmd(&out, F("AT+CWJAP_CUR=\""), ssid, F("\",\""), pwd, F("\""));
+			bytes += printCmd(&out, F("AT+CIPSTART="), (uint8_t)1, F(",\""), "TCP", F("\",\""), "192.168.1.10", F("\","), (uint16_t)8080);
+			bytes += printCmd(&out, F("AT+CIPSEND="), (uint8_t)1, F(","), (uint16_t)1460);
+		}
+		timer.report("cmd: CmdArgs streamed", bytes);
+	}
+
+	// the same commands are written by both
+	if (diff!=(long)bytes)
+		printf("cmd: different lengths (%ld, %zu)\n", diff, bytes);
+	sink = bytes;
+}
+
+int main(int argc, char** argv)
+{
+	repeat = argc>1 ? atoi(argv[1]) : 2000;
+
+	std::string transcript = recordSession();
+	printf("AT transcript of %zu bytes, %d times\n", transcript.size(), repeat);
+
+	benchTagMatch(transcript);
+	benchRingBuffer();
+	benchRead();
+	benchCmd();
+
+	return 0;
+}
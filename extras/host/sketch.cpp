@@ -0,0 +1,21 @@
+/*
+ * Host build of an example sketch (make examples). Like the Arduino IDE,
+ * the prototypes of the functions of the sketch are declared before it.
+ * The sketches are only built: they wait for a module on Serial1.
+ *
+ * SKETCH and SKETCH_PROTOTYPES are the paths of the .ino file and of the
+ * prototypes extracted from it by the Makefile.
+ */
+#include <Arduino.h>
+#include <WizFi360.h>
+#include <WizFi360Udp.h>
+
+#include SKETCH_PROTOTYPES
+#include SKETCH
+
+int main()
+{
+	setup();
+	for (;;)
+		loop();
+}
@@ -0,0 +1,29 @@
+/*
+ * Minimal checks for the host tests: each test program returns the
+ * number of failed checks.
+ */
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+
+static int testFailures = 0;
+
+#define CHECK(cond) do { \
+	if (not (cond)) { \
+		printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		testFailures++; \
+	} \
+} while (0)
+
+#define CHECK_EQUAL(a, b) do { \
+	long _a = (long)(a), _b = (long)(b); \
+	if (_a!=_b) { \
+		printf("%s:%d: CHECK_EQUAL(%s, %s) failed: %ld != %ld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+		testFailures++; \
+	} \
+} while (0)
+
+#define TEST_RESULT() (printf("%s: %s\n", __FILE__, testFailures ? "FAILED" : "ok"), testFailures)
+
+#endif
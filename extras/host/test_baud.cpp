@@ -0,0 +1,63 @@
+/*
+ * Runtime baud rate change with AT+UART_CUR and its rollback.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static unsigned long moduleBaud = 115200;
+static unsigned long hostBaud = 115200;
+static unsigned long maxBaud = 921600;     // refused above
+static bool deaf;                          // accepts but does not answer at the new rate
+
+static void setHostBaud(unsigned long baud, bool flowControl)
+{
+	hostBaud = baud;
+}
+
+static void uartModule(MockModule& m, const std::string& line)
+{
+	// garbled
+	if (hostBaud!=moduleBaud)
+		return;
+
+	if (line.compare(0, 12, "AT+UART_CUR=")==0)
+	{
+		unsigned long baud = strtoul(line.c_str()+12, NULL, 10);
+		if (baud>maxBaud)
+		{
+			m.reply("\r\nERROR\r\n");
+			return;
+		}
+		m.reply("\r\nOK\r\n");
+		moduleBaud = (deaf and baud!=115200) ? 1 : baud;
+	}
+	else
+		MockModule::respond(m, line);
+}
+
+int main()
+{
+	WiFi.init(&module);
+	module.onLine = uartModule;
+
+	CHECK(WiFi.setBaudRate(921600, 115200, setHostBaud, true));
+	CHECK_EQUAL(moduleBaud, 921600);
+	CHECK_EQUAL(hostBaud, 921600);
+
+	// refused: the serial port is not switched
+	CHECK(!WiFi.setBaudRate(2000000, 921600, setHostBaud));
+	CHECK_EQUAL(hostBaud, 921600);
+	CHECK(strcmp(WiFi.firmwareVersion(), "1.1.1.7")==0);
+
+	// no answer at the new rate: back to the previous one
+	moduleBaud = hostBaud = 115200;
+	deaf = true;
+	CHECK(!WiFi.setBaudRate(460800, 115200, setHostBaud));
+	CHECK_EQUAL(hostBaud, 115200);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+/*
+ * Queued AT command engine: poll() steps, completion callbacks, timeouts
+ * and the blocking wrappers.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static int lastTag;
+static int calls;
+
+static void done(int tag, void* ctx)
+{
+	lastTag = tag;
+	calls++;
+	if (ctx)
+		*(int*)ctx = calls;
+}
+
+static void testAsyncCommand()
+{
+	calls = 0;
+	CHECK(WiFi.sendCommand(F("AT+CWJAP_CUR=\"ssid\",\"pass\""), 20000, done));
+
+	unsigned long start = millis();
+	int polls = 0;
+	while (WiFi.commandPending())
+	{
+		WiFi.poll();
+		polls++;
+	}
+
+	// the answer comes after 300 ms, poll() returned in between
+	CHECK_EQUAL(calls, 1);
+	CHECK_EQUAL(lastTag, TAG_OK);
+	CHECK(millis()-start >= 300);
+	CHECK(polls > 1);
+}
+
+static void testQueueOrder()
+{
+	int first = 0, second = 0;
+	calls = 0;
+	CHECK(WiFi.sendCommand(F("AT+CWJAP_CUR=\"ssid\",\"pass\""), 20000, done, &first));
+	CHECK(WiFi.sendCommand("AT+CIPMUX=1", 1000, done, &second));
+	while (WiFi.commandPending())
+		WiFi.poll();
+
+	CHECK_EQUAL(first, 1);
+	CHECK_EQUAL(second, 2);
+}
+
+static void testTimeout()
+{
+	module.onLine = [](MockModule& m, const std::string& line) {
+		if (line!="AT+SLEEP=0")
+			MockModule::respond(m, line);
+	};
+
+	calls = 0;
+	lastTag = 0;
+	CHECK(WiFi.sendCommand(F("AT+SLEEP=0"), 500, done));
+	unsigned long start = millis();
+	while (WiFi.commandPending())
+		WiFi.poll();
+
+	CHECK_EQUAL(calls, 1);
+	CHECK_EQUAL(lastTag, -1);
+	CHECK(millis()-start >= 500);
+
+	module.onLine = MockModule::respond;
+}
+
+static void testError()
+{
+	module.onLine = [](MockModule& m, const std::string& line) {
+		if (line=="AT+CWMODE_CUR=9")
+			m.reply("\r\nERROR\r\n");
+		else
+			MockModule::respond(m, line);
+	};
+
+	CHECK(WiFi.sendCommand(F("AT+CWMODE_CUR=9"), 1000, done));
+	while (WiFi.commandPending())
+		WiFi.poll();
+	CHECK_EQUAL(lastTag, TAG_ERROR);
+
+	module.onLine = MockModule::respond;
+}
+
+static void testBlockingWrappers()
+{
+	CHECK(strcmp(WiFi.firmwareVersion(), "1.1.1.7")==0);
+
+	WiFiClient client;
+	CHECK_EQUAL(client.connect("1.2.3.4", 80), 1);
+	CHECK_EQUAL(client.write((const uint8_t*)"hello", 5), 5);
+	client.flush();
+	CHECK(module.lastData=="hello");
+	client.stop();
+}
+
+// collected only when compiled with WIZFI360_STATS=1
+static void testStats()
+{
+	WizFi360Stats stats;
+	memset(&stats, 0, sizeof(stats));
+	CHECK_EQUAL(WiFi.getStats(stats), WIZFI360_STATS==1);
+	if (WIZFI360_STATS)
+	{
+		CHECK(stats.cmdCount[STATS_CMD_START]>0);
+		uint32_t linkTx = 0;
+		for (int i=0; i<MAX_SOCK_NUM; i++)
+			linkTx += stats.linkTx[i];
+		CHECK_EQUAL(linkTx, 5);
+		CHECK(stats.uartTx>0);
+		CHECK(stats.timeouts>0);
+	}
+	WiFi.resetStats();
+	WiFi.getStats(stats);
+	CHECK_EQUAL(stats.uartTx, 0);
+}
+
+int main()
+{
+	WiFi.init(&module);
+
+	testAsyncCommand();
+	testQueueOrder();
+	testTimeout();
+	testError();
+	testBlockingWrappers();
+	testStats();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,81 @@
+/*
+ * Unsolicited notifications of the module, alone or in the middle of the
+ * response of a command.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static int events[EVENT_LINK_DATA+1];
+
+static void onEvent(uint8_t event, uint8_t link)
+{
+	events[event]++;
+}
+
+static void testStatusQuery()
+{
+	// the disconnection is more recent than the status line
+	module.onLine = [](MockModule& m, const std::string& line) {
+		if (line=="AT+CIPSTATUS")
+			m.reply("WIFI DISCONNECT\r\nSTATUS:2\r\n\r\nOK\r\n");
+		else
+			MockModule::respond(m, line);
+	};
+	CHECK_EQUAL(WiFi.status(), WL_DISCONNECTED);
+	CHECK_EQUAL(events[EVENT_WIFI_DISCONNECT], 1);
+	module.onLine = MockModule::respond;
+}
+
+static void testWifiEvents()
+{
+	CHECK_EQUAL(WiFi.begin("ssid", "pass"), WL_CONNECTED);
+	CHECK_EQUAL(events[EVENT_WIFI_CONNECTED], 1);
+	CHECK_EQUAL(events[EVENT_WIFI_GOT_IP], 1);
+
+	module.reply("WIFI DISCONNECT\r\n");
+	CHECK_EQUAL(WiFi.status(), WL_DISCONNECTED);
+
+	// in the response of AT+CIFSR
+	module.onLine = [](MockModule& m, const std::string& line) {
+		if (line=="AT+CIFSR")
+			m.reply("+CIFSR:STAIP,\"192.168.1.5\"\r\nWIFI GOT IP\r\n+CIFSR:STAMAC,\"00:08:dc:11:22:33\"\r\n\r\nOK\r\n");
+		else
+			MockModule::respond(m, line);
+	};
+	IPAddress ip = WiFi.localIP();
+	CHECK_EQUAL(ip[3], 5);
+	CHECK_EQUAL(WiFi.status(), WL_CONNECTED);
+	module.onLine = MockModule::respond;
+}
+
+static void testLinkClosed()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	module.reply("\r\n+IPD," + std::to_string(link) + ",4,\"1.2.3.4\",80:abcd" + std::to_string(link) + ",CLOSED\r\n");
+	std::string data;
+	while (client.available())
+		data += (char)client.read();
+	CHECK(data=="abcd");
+	CHECK(!client.connected());
+	CHECK_EQUAL(events[EVENT_LINK_DATA], 1);
+	CHECK_EQUAL(events[EVENT_LINK_CLOSED], 1);
+}
+
+int main()
+{
+	WiFi.init(&module);
+	WiFi.onEvent(onEvent);
+
+	testStatusQuery();
+	testWifiEvents();
+	testLinkClosed();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,242 @@
+/*
+ * Data packets (+IPD): incremental parsing of the header, demultiplexing
+ * to the receive buffers of the links, data kept by the module in passive
+ * receive mode and loss of data when a buffer is full.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static int closedEvents;
+
+static void onEvent(uint8_t event, uint8_t link)
+{
+	if (event==EVENT_LINK_CLOSED)
+		closedEvents++;
+}
+
+static std::string ipd(int link, const std::string& data)
+{
+	return "\r\n+IPD," + std::to_string(link) + "," + std::to_string(data.size()) + ",\"1.2.3.4\",80:" + data;
+}
+
+static std::string readAll(WiFiClient& client)
+{
+	std::string s;
+	uint8_t buf[100];
+	while (client.available())
+	{
+		int n = client.read(buf, sizeof(buf));
+		if (n<=0)
+			break;
+		s.append((const char*)buf, n);
+	}
+	return s;
+}
+
+static void testFragmentedHeader()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// one character per poll(), which never waits for the rest
+	std::string packet = "\r\n+IPD," + std::to_string(link) + ",5,\"10.0.0.7\",8080:hello";
+	unsigned long start = millis();
+	for (size_t i=0; i<packet.size(); i++)
+	{
+		module.reply(packet.substr(i, 1));
+		WiFi.poll();
+	}
+	CHECK(millis()-start < 10);
+	CHECK(readAll(client)=="hello");
+	CHECK_EQUAL(client.remoteIP()[3], 7);
+
+	// header without the remote address, the payload arriving later
+	module.reply("\r\n+IPD," + std::to_string(link) + ",3");
+	WiFi.poll();
+	CHECK_EQUAL(client.available(), 0);
+	module.reply(":xy");
+	WiFi.poll();
+	module.reply("z");
+	CHECK(readAll(client)=="xyz");
+
+	// an invalid header is skipped, the next packet is received
+	module.reply("\r\n+IPD," + std::to_string(link) + ",x\r\n");
+	WiFi.poll();
+	module.reply(ipd(link, "ok"));
+	CHECK(readAll(client)=="ok");
+
+	client.stop();
+}
+
+static void testLastByte()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// reading the last byte does not wait for a CLOSED notification
+	module.reply(ipd(link, "ab"));
+	CHECK_EQUAL(client.available(), 2);
+	unsigned long start = micros();
+	CHECK_EQUAL(client.read(), 'a');
+	CHECK_EQUAL(client.read(), 'b');
+	CHECK(micros()-start < 1000);
+	CHECK(client.connected());
+
+	// the notification following the data is seen by the read of the last byte
+	module.reply(ipd(link, "z") + std::to_string(link) + ",CLOSED\r\n");
+	CHECK_EQUAL(client.available(), 1);
+	CHECK_EQUAL(client.read(), 'z');
+	CHECK(!client);
+}
+
+static void testTwoLinks()
+{
+	WiFiClient a, b;
+	CHECK(a.connect("1.1.1.1", 1));
+	int linkA = *module.links.begin();
+	CHECK(b.connect("2.2.2.2", 2));
+	int linkB = linkA==*module.links.begin() ? *module.links.rbegin() : *module.links.begin();
+
+	module.reply(ipd(linkA, "AAA") + ipd(linkB, "BB"));
+	CHECK(readAll(a)=="AAA");
+	CHECK(readAll(b)=="BB");
+
+	// a packet arriving in the response of a command goes to its link too
+	module.onLine = [=](MockModule& m, const std::string& line) {
+		if (line=="AT+CIPSTATUS")
+			m.reply("STATUS:3\r\n" + ipd(linkA, "ok") + "\r\n+CIPSTATUS:" + std::to_string(linkA) + ",\"TCP\"\r\n\r\nOK\r\n");
+		else
+			MockModule::respond(m, line);
+	};
+	CHECK(WiFi.sendCommand(F("AT+CIPSTATUS"), 1000, NULL));
+	while (WiFi.commandPending())
+		WiFi.poll();
+	module.onLine = MockModule::respond;
+	CHECK(readAll(a)=="ok");
+
+	a.stop();
+	b.stop();
+}
+
+static void testPassiveReceive()
+{
+	WiFiClient a, b;
+	CHECK(a.connect("1.1.1.1", 1));
+	int linkA = *module.links.begin();
+	CHECK(b.connect("2.2.2.2", 2));
+	int linkB = linkA==*module.links.begin() ? *module.links.rbegin() : *module.links.begin();
+	CHECK(module.passive);
+
+	// a full TCP segment arrives on a link while the other one is sending
+	std::string segment(1460, 's');
+	module.onData = [&](MockModule& m, const std::string& data) {
+		m.receive(linkA, segment);
+		MockModule::respondData(m, data);
+	};
+	closedEvents = 0;
+	b.print("request");
+	b.flush();
+	module.onData = MockModule::respondData;
+
+	// the module kept it, it is read in full by pieces
+	CHECK_EQUAL(closedEvents, 0);
+	CHECK(readAll(a)==segment);
+	CHECK(a.connected());
+	CHECK(module.sent.find("AT+CIPRECVDATA=" + std::to_string(linkA) + ",")!=std::string::npos);
+
+	// the data kept when the link is closed is still read
+	module.receive(linkB, "bye");
+	module.reply(std::to_string(linkB) + ",CLOSED\r\n");
+	WiFi.poll();
+	CHECK_EQUAL(b.available(), 3);
+	CHECK_EQUAL(b.read(), 'b');
+	CHECK_EQUAL(b.read(), 'y');
+	CHECK_EQUAL(b.read(), 'e');
+	CHECK(!b.connected());
+	module.links.erase(linkB);
+
+	a.stop();
+	b.stop();
+}
+
+static std::string callbackData;
+
+static void onReceive(uint8_t sock, const uint8_t* data, size_t len)
+{
+	callbackData.append((const char*)data, len);
+}
+
+static void testRecvCallback()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// the callback takes the data as it arrives
+	WiFi.onReceive(onReceive);
+	CHECK(!module.passive);
+	callbackData.clear();
+	module.receive(link, "direct");
+	WiFi.poll();
+	CHECK(callbackData=="direct");
+	CHECK_EQUAL(client.available(), 0);
+
+	WiFi.onReceive(NULL);
+	CHECK(module.passive);
+	module.receive(link, "kept");
+	CHECK(readAll(client)=="kept");
+
+	client.stop();
+}
+
+// The data sent as it arrives, by a firmware without the passive receive
+// mode or on UDP, can only be dropped
+static void testOverflowClosesLink()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// more data than the receive buffer while a command is running
+	std::string data(SOCK_RX_BUFFER_SIZE + 100, 'x');
+	module.onLine = [&](MockModule& m, const std::string& line) {
+		if (line=="AT+CWJAP?")
+			m.reply(ipd(link, data));
+		MockModule::respond(m, line);
+	};
+	closedEvents = 0;
+	module.sent.clear();
+	CHECK(WiFi.sendCommand(F("AT+CWJAP?"), 1000, NULL));
+	while (WiFi.commandPending())
+		WiFi.poll();
+	module.onLine = MockModule::respond;
+
+	CHECK_EQUAL(closedEvents, 1);
+
+	// the data received before the loss is still read, then the link is closed
+	CHECK_EQUAL(readAll(client).size(), SOCK_RX_BUFFER_SIZE);
+	CHECK(!client.connected());
+	CHECK(module.sent.find("AT+CIPCLOSE=" + std::to_string(link))!=std::string::npos);
+	CHECK(module.links.empty());
+}
+
+int main()
+{
+	WiFi.init(&module);
+	WiFi.onEvent(onEvent);
+
+	testFragmentedHeader();
+	testLastByte();
+	testTwoLinks();
+	testPassiveReceive();
+	testRecvCallback();
+	testOverflowClosesLink();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,97 @@
+/*
+ * Replay of a SerialRecorder transcript: a session recorded with the
+ * scripted module is run again against the transcript alone.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "Replay.h"
+#include "test.h"
+
+// Keeps the output of SerialRecorder::dump
+class StringPrint : public Print
+{
+public:
+	size_t write(uint8_t c) { s += (char)c; return 1; }
+	std::string s;
+};
+
+static std::string body = "HTTP/1.0 200 OK\r\nContent-Length: 5\r\n\r\nhello";
+
+// The calls of the sketch, with the data sent by the server when the
+// scripted module is recorded
+static std::string session(MockModule* module)
+{
+	WiFi.begin("myssid", "password");
+
+	WiFiClient client;
+	client.connect("1.2.3.4", 80);
+	client.print(F("GET / HTTP/1.0\r\n\r\n"));
+	client.flush();
+	if (module!=NULL)
+		module->receive(*module->links.begin(), body, 50);
+
+	std::string got;
+	unsigned long start = millis();
+	while (got.size()<body.size() and millis()-start<1000)
+	{
+		int c = client.read();
+		if (c>=0)
+			got += (char)c;
+	}
+	client.stop();
+	return got;
+}
+
+static void testFormat()
+{
+	Replay replay;
+	CHECK(replay.load("0 > 41540D0A\r\n12 < 0D0A4F4B0D0A\r\n\r\n"));
+	CHECK(replay.expected=="AT\r\n");
+	CHECK_EQUAL(replay.duration(), 12);
+
+	CHECK(!Replay().load("0 = 41"));
+	CHECK(!Replay().load("0 > 4"));
+	CHECK(!Replay().load("0 > 4G"));
+	CHECK(!Replay().load("> 41"));
+}
+
+static void testReplay()
+{
+	MockModule module;
+	module.baud = 115200;
+	module.latency = 1000;
+	module.passive = true;
+
+	SerialRecorder recorder(&module);
+	unsigned long start = hostMicros;
+	WiFi.init(&recorder);
+	CHECK(session(&module)==body);
+	unsigned long recorded = (hostMicros-start)/1000;
+
+	StringPrint dump;
+	recorder.dump(&dump);
+
+	Replay replay;
+	CHECK(replay.load(dump.s));
+	CHECK(not replay.expected.empty());
+	CHECK(replay.expected==module.sent);
+
+	// the driver does the same against the transcript, in the same time
+	start = hostMicros;
+	WiFi.init(&replay);
+	CHECK(session(NULL)==body);
+	unsigned long replayed = (hostMicros-start)/1000;
+	CHECK(replay.done());
+	CHECK(replay.sent==replay.expected);
+	CHECK(replayed+5 >= recorded and replayed <= recorded+5);
+	CHECK(replay.duration() <= replayed);
+}
+
+int main()
+{
+	testFormat();
+	testReplay();
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+/*
+ * Network scan: streamed to a callback, or kept for the legacy API.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static bool sorted = true;
+static std::string found;
+
+static void scanModule(MockModule& m, const std::string& line)
+{
+	if (line=="AT+CWLAPOPT=1,7")
+		m.reply(sorted ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+	else if (line=="AT+CWLAP")
+	{
+		// 12 networks, by decreasing RSSI if sorted
+		std::string r;
+		for (int i=0; i<12; i++)
+			r += "+CWLAP:(" + std::to_string(i%5) + ",\"net" + std::to_string(i) + "\"," + std::to_string(sorted ? -30-i : -80+i) + ")\r\n";
+		m.reply(r + "\r\nOK\r\n");
+	}
+	else
+		MockModule::respond(m, line);
+}
+
+static void onNetwork(const char* ssid, int32_t rssi, uint8_t encType, void* ctx)
+{
+	found += std::string(ssid) + "," + std::to_string(rssi) + "," + std::to_string(encType) + ";";
+}
+
+int main()
+{
+	WiFi.init(&module);
+
+	// the default answer of the scripted module
+	CHECK_EQUAL(WiFi.scanNetworks(onNetwork), 3);
+	CHECK(found=="home,-45,3;guest,-60,0;office,-72,4;");
+
+	module.onLine = scanModule;
+	found.clear();
+	CHECK_EQUAL(WiFi.scanNetworks(onNetwork, NULL, 3), 3);
+	CHECK(found=="net0,-30,0;net1,-31,1;net2,-32,2;");
+
+	// not sorted by the module: the strongest ones are kept
+	sorted = false;
+	CHECK_EQUAL(WiFi.scanNetworks(), WL_NETWORKS_LIST_MAXNUM);
+	int weakest = 0;
+	for (int i=0; i<WL_NETWORKS_LIST_MAXNUM; i++)
+	{
+		CHECK(WiFi.RSSI(i) >= -78);
+		if (WiFi.RSSI(i)==-78)
+			weakest++;
+	}
+	CHECK_EQUAL(weakest, 1);
+	CHECK(strcmp(WiFi.SSID(0), "net10")==0);
+
+	// the list is shared by the drivers
+	WizFi360Drv other;
+	CHECK(strcmp(other.getSSIDNetoworks(0), "net10")==0);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,158 @@
+/*
+ * Client writes: coalescing of the small writes and split of the large
+ * ones in several AT+CIPSEND.
+ */
+#include <WizFi360.h>
+#include <WizFi360Udp.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+#include <vector>
+
+static MockModule module;
+
+static std::vector<std::string> payloads;
+
+static void recordData(MockModule& m, const std::string& data)
+{
+	payloads.push_back(data);
+	MockModule::respondData(m, data);
+}
+
+static unsigned long txSends()
+{
+	unsigned long sends, saved;
+	WiFi.getTxCounters(&sends, &saved);
+	return sends;
+}
+
+static void testCoalescing(WiFiClient& client)
+{
+	payloads.clear();
+	client.println(F("HTTP/1.1 200 OK"));
+	client.print("analog ");
+	client.print(3);
+	client.println();
+	CHECK(payloads.empty());
+
+	// sent before waiting for the reply
+	client.available();
+	CHECK_EQUAL(payloads.size(), 1);
+	CHECK(payloads[0]=="HTTP/1.1 200 OK\r\nanalog 3\r\n");
+
+	// or after an idle time
+	client.print("x");
+	unsigned long start = millis();
+	while (millis()-start < SOCK_TX_FLUSH_TIME+10)
+		WiFi.poll();
+	CHECK_EQUAL(payloads.size(), 2);
+	CHECK(payloads[1]=="x");
+
+	// flush only sends, the reply stays for the client
+	module.echo = true;
+	client.print("ping");
+	client.flush();
+	CHECK_EQUAL(payloads.size(), 3);
+	delay(20);
+	CHECK_EQUAL(client.available(), 4);
+	char buf[8] = {0};
+	CHECK_EQUAL(client.read((uint8_t*)buf, sizeof(buf)), 4);
+	CHECK(strcmp(buf, "ping")==0);
+	module.echo = false;
+}
+
+static void testSplit(WiFiClient& client)
+{
+	payloads.clear();
+	unsigned long sends = txSends();
+
+	std::string big(5000, 'b');
+	CHECK_EQUAL(client.write((const uint8_t*)big.data(), big.size()), big.size());
+	CHECK_EQUAL(payloads.size(), 3);
+	CHECK_EQUAL(payloads[0].size(), MAX_SEND_SIZE);
+	CHECK_EQUAL(payloads[1].size(), MAX_SEND_SIZE);
+	CHECK_EQUAL(payloads[2].size(), 5000-2*MAX_SEND_SIZE);
+
+	// a flash string, CR LF with its last part
+	std::string text(MAX_SEND_SIZE+52, 'f');
+	client.println((const __FlashStringHelper*)text.c_str());
+	CHECK_EQUAL(payloads.size(), 5);
+	CHECK_EQUAL(payloads[3].size(), MAX_SEND_SIZE);
+	CHECK(payloads[4]==std::string(52, 'f') + "\r\n");
+
+	// one count per AT+CIPSEND
+	CHECK_EQUAL(txSends()-sends, 5);
+}
+
+static void testWritev(WiFiClient& client)
+{
+	payloads.clear();
+
+	// each AT+CIPSEND is filled across the fragments
+	std::string body(3000, 'w');
+	DataFragment frags[] = {
+		{ "HEAD", 4, false },
+		{ body.data(), body.size(), false },
+	};
+	CHECK_EQUAL(client.writev(frags, 2), 3004);
+	CHECK_EQUAL(payloads.size(), 2);
+	CHECK(payloads[0]=="HEAD" + body.substr(0, MAX_SEND_SIZE-4));
+	CHECK(payloads[1]==body.substr(MAX_SEND_SIZE-4));
+
+	// fragments in flash and in RAM, the slice ends inside the last one
+	std::string flash(MAX_SEND_SIZE-2, 'p');
+	DataFragment mixed[] = {
+		{ flash.c_str(), flash.size(), true },
+		dataFragment("abc"),
+		dataFragment(F("de")),
+	};
+	payloads.clear();
+	CHECK_EQUAL(client.writev(mixed, 3), MAX_SEND_SIZE+3);
+	client.flush();
+	CHECK_EQUAL(payloads.size(), 2);
+	CHECK(payloads[0]==flash + "ab");
+	CHECK(payloads[1]=="cde");
+}
+
+static void testUdp()
+{
+	WiFiUDP udp;
+	CHECK(udp.beginPacket("1.2.3.4", 5000));
+
+	// a datagram is not split
+	payloads.clear();
+	std::string body(3000, 'u');
+	DataFragment frags[] = {
+		dataFragment(F("HEAD")),
+		dataFragment(body.data(), body.size()),
+	};
+	CHECK_EQUAL(udp.writev(frags, 2), 0);
+	CHECK_EQUAL(udp.write((const uint8_t*)body.data(), body.size()), 0);
+	CHECK(payloads.empty());
+
+	frags[1].len = MAX_SEND_SIZE-4;
+	CHECK_EQUAL(udp.writev(frags, 2), MAX_SEND_SIZE);
+	CHECK_EQUAL(payloads.size(), 1);
+	CHECK(payloads[0]=="HEAD" + body.substr(0, MAX_SEND_SIZE-4));
+
+	udp.stop();
+}
+
+int main()
+{
+	WiFi.init(&module);
+	module.onData = recordData;
+
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+
+	testCoalescing(client);
+	testSplit(client);
+	testWritev(client);
+
+	client.stop();
+
+	testUdp();
+	return TEST_RESULT();
+}
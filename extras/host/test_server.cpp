@@ -0,0 +1,45 @@
+/*
+ * Server: links accepted by the module.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+int main()
+{
+	WiFi.init(&module);
+
+	WiFiServer server(80);
+	module.sent.clear();
+	server.begin();
+
+	// the module accepts only the links handled by the driver
+	std::string expected = "AT+CIPSERVERMAXCONN=" + std::to_string(MAX_SOCK_NUM) + "\r\nAT+CIPSERVER=1,80\r\n";
+	CHECK(module.sent==expected);
+
+	module.reply("0,CONNECT\r\n\r\n+IPD,0,5,\"9.9.9.9\",5000:GET /");
+	WiFiClient client = server.available();
+	CHECK(client);
+	CHECK_EQUAL(client.available(), 5);
+	CHECK_EQUAL(client.remoteIP()[0], 9);
+
+	client.stop();
+	CHECK(module.sent.find("AT+CIPCLOSE=0\r\n")!=std::string::npos);
+
+	// server of a second module
+	MockModule module2;
+	WizFi360Drv drv2;
+	WizFi360Class wifi2(drv2);
+	wifi2.init(&module2);
+	WiFiServer server2(drv2, 8080);
+	module.sent.clear();
+	module2.sent.clear();
+	server2.begin();
+	CHECK(module.sent.empty());
+	CHECK(module2.sent.find("AT+CIPSERVER=1,8080\r\n")!=std::string::npos);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+/*
+ * Transparent transmission: the serial stream carries only the data of
+ * the connection, the AT paths must not write to it or read from it.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static bool passThrough;
+static std::string payload;
+
+static void transparentModule(MockModule& m, const std::string& line)
+{
+	if (passThrough)
+	{
+		payload += line + "\r\n";
+		return;
+	}
+
+	// the escape sequence is not followed by a line end
+	std::string cmd = line.compare(0, 3, "+++")==0 ? line.substr(3) : line;
+	if (cmd=="AT+CIPSEND")
+	{
+		passThrough = true;
+		m.reply("\r\nOK\r\n\r\n>");
+	}
+	else if (cmd.compare(0, 17, "AT+CIPSTART=\"TCP\"")==0)
+		m.reply("CONNECT\r\n\r\nOK\r\n");
+	else
+		MockModule::respond(m, cmd);
+}
+
+static void scanResult(const char* ssid, int32_t rssi, uint8_t encType, void* ctx)
+{
+}
+
+int main()
+{
+	WiFi.init(&module);
+	module.onLine = transparentModule;
+
+	WiFiClient client;
+	CHECK(client.connectTransparent("1.2.3.4", 80));
+	CHECK(client.connected());
+
+	client.print(F("GET / HTTP/1.0\r\n\r\n"));
+	CHECK(payload=="GET / HTTP/1.0\r\n\r\n");
+
+	// data looking like AT responses stays for the client
+	std::string data = "HTTP/1.0 200 OK\r\n\r\nOK\r\nready\r\n";
+	module.reply(data);
+	CHECK_EQUAL(client.available(), data.size());
+
+	size_t sent = module.sent.size();
+	CHECK(!WiFi.sendCommand(F("AT+CWJAP?"), 1000, NULL));
+	CHECK_EQUAL(WiFi.scanNetworks(scanResult), -1);
+	CHECK(!WiFi.ping("1.2.3.4"));
+	unsigned long start = millis();
+	WiFi.reset();
+	CHECK(millis()-start < 100);
+	WiFi.poll();
+	CHECK_EQUAL(module.sent.size(), sent);
+
+	char buf[64] = {0};
+	CHECK_EQUAL(client.read((uint8_t*)buf, sizeof(buf)-1), data.size());
+	CHECK(data==buf);
+
+	passThrough = false;
+	client.stop();
+	CHECK(!client.connected());
+	CHECK(module.sent.find("+++AT+CIPMODE=0\r\n")!=std::string::npos);
+
+	// back to the AT commands
+	CHECK(strcmp(WiFi.firmwareVersion(), "1.1.1.7")==0);
+
+	return TEST_RESULT();
+}
@@ -0,0 +1,117 @@
+/*
+ * Send window: segments sent with AT+CIPSENDBUF without waiting for their
+ * SEND OK, acknowledgements, failures and drain before closing.
+ */
+#include <WizFi360.h>
+
+#include "MockModule.h"
+#include "test.h"
+
+static MockModule module;
+
+static std::string segment(200, 's');
+
+static size_t writeSegment(WiFiClient& client)
+{
+	return client.write((const uint8_t*)segment.data(), segment.size());
+}
+
+static void testNotSupported()
+{
+	module.onLine = [](MockModule& m, const std::string& line) {
+		if (line=="AT+CIPSENDBUF=?")
+			m.reply("\r\nERROR\r\n");
+		else
+			MockModule::respond(m, line);
+	};
+	CHECK(!WiFi.setSendWindow(4));
+	module.onLine = MockModule::respond;
+
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	module.sent.clear();
+	CHECK_EQUAL(writeSegment(client), segment.size());
+	CHECK(module.sent.find("AT+CIPSEND=")!=std::string::npos);
+	CHECK(module.sent.find("AT+CIPSENDBUF=")==std::string::npos);
+	client.stop();
+}
+
+static void testWindow()
+{
+	CHECK(WiFi.setSendWindow(4));
+	module.sendTime = 50;
+
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// up to 4 segments are in flight without waiting
+	unsigned long start = millis();
+	for (int i=0; i<4; i++)
+		CHECK_EQUAL(writeSegment(client), segment.size());
+	CHECK(millis()-start < module.sendTime);
+	CHECK_EQUAL(module.segments[link], 4);
+	CHECK_EQUAL(module.acked[link], 0);
+
+	// the fifth one waits for the SEND OK of the first one
+	CHECK_EQUAL(writeSegment(client), segment.size());
+	CHECK(millis()-start >= module.sendTime);
+	CHECK(module.acked[link] >= 1);
+	CHECK_EQUAL(module.segments[link], 5);
+	CHECK(module.lastData==segment);
+
+	// the link is closed once every segment is acknowledged
+	int ackedAtClose = -1;
+	module.onLine = [&](MockModule& m, const std::string& line) {
+		if (line.compare(0, 12, "AT+CIPCLOSE=")==0)
+			ackedAtClose = m.acked[link];
+		MockModule::respond(m, line);
+	};
+	client.stop();
+	module.onLine = MockModule::respond;
+	CHECK_EQUAL(ackedAtClose, 5);
+
+	module.sendTime = 0;
+}
+
+static void testSendFail()
+{
+	WiFiClient client;
+	CHECK(client.connect("1.2.3.4", 80));
+	int link = *module.links.begin();
+
+	// the second segment is not delivered
+	module.onData = [=](MockModule& m, const std::string& data) {
+		if (m.segments[link]==2)
+		{
+			m.reply("\r\nRecv " + std::to_string(data.size()) + " bytes\r\n");
+			m.later(std::to_string(link) + ",2,SEND FAIL\r\n", 5);
+		}
+		else
+			MockModule::respondData(m, data);
+	};
+	CHECK_EQUAL(writeSegment(client), segment.size());
+	CHECK_EQUAL(writeSegment(client), segment.size());
+
+	// the failure is reported by the next write
+	delay(10);
+	client.available();
+	CHECK_EQUAL(writeSegment(client), 0);
+	CHECK(client.getWriteError());
+	CHECK_EQUAL(module.segments[link], 2);
+	module.onData = MockModule::respondData;
+
+	client.stop();
+	CHECK(WiFi.setSendWindow(0));
+}
+
+int main()
+{
+	WiFi.init(&module);
+
+	testNotSupported();
+	testWindow();
+	testSendFail();
+
+	return TEST_RESULT();
+}
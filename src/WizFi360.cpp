@@ -18,37 +18,39 @@ along with The Arduino WizFi360 library.  If not, see
 
 #include "WizFi360.h"
 
-
-int16_t 	WizFi360Class::_state[MAX_SOCK_NUM] = { NA_STATE, NA_STATE, NA_STATE, NA_STATE };
-uint16_t 	WizFi360Class::_server_port[MAX_SOCK_NUM] = { 0, 0, 0, 0 };
-
-
-uint8_t WizFi360Class::wizfi360Mode = 0;
-
+// referenced by init(), see WIZFI360_LAYOUT
+const uint8_t WIZFI360_LAYOUT = 0;
 
 WizFi360Class::WizFi360Class()
 {
+	_drv = &wizfi360Drv;
+	wizfi360Mode = 0;
+}
 
+WizFi360Class::WizFi360Class(WizFi360Drv& drv)
+{
+	_drv = &drv;
+	wizfi360Mode = 0;
 }
 
-void WizFi360Class::init(Stream* wizfi360Serial)
+void WizFi360Class::initModule(Stream* wizfi360Serial, const uint8_t* layout)
 {
     LOGINFO(F("Initializing WizFi360 module"));
-	WizFi360Drv::wifiDriverInit(wizfi360Serial);
+	_drv->wifiDriverInit(wizfi360Serial);
 }
 
 
 
 char* WizFi360Class::firmwareVersion()
 {
-	return WizFi360Drv::getFwVersion();
+	return _drv->getFwVersion();
 }
 
 
 int WizFi360Class::begin(const char* ssid, const char* passphrase)
 {
     wizfi360Mode = 1;
-	if (WizFi360Drv::wifiConnect(ssid, passphrase))
+	if (_drv->wifiConnect(ssid, passphrase))
 		return WL_CONNECTED;
 
 	return WL_CONNECT_FAILED;
@@ -62,7 +64,7 @@ int WizFi360Class::beginAP(const char* ssid, uint8_t channel, const char* pwd, u
     else
         wizfi360Mode = 3;
     
-    if (WizFi360Drv::wifiStartAP(ssid, pwd, channel, enc, wizfi360Mode))
+    if (_drv->wifiStartAP(ssid, pwd, channel, enc, wizfi360Mode))
 		return WL_CONNECTED;
 
 	return WL_CONNECT_FAILED;
@@ -81,25 +83,25 @@ int WizFi360Class::beginAP(const char* ssid, uint8_t channel)
 
 void WizFi360Class::config(IPAddress ip)
 {
-	WizFi360Drv::config(ip);
+	_drv->config(ip);
 }
 
 void WizFi360Class::configAP(IPAddress ip)
 {
-	WizFi360Drv::configAP(ip);
+	_drv->configAP(ip);
 }
 
 
 
 int WizFi360Class::disconnect()
 {
-    return WizFi360Drv::disconnect();
+    return _drv->disconnect();
 }
 
 uint8_t* WizFi360Class::macAddress(uint8_t* mac)
 {
 	// TODO we don't need _mac variable
-	uint8_t* _mac = WizFi360Drv::getMacAddress();
+	uint8_t* _mac = _drv->getMacAddress();
 	memcpy(mac, _mac, WL_MAC_ADDR_LENGTH);
     return mac;
 }
@@ -108,9 +110,9 @@ IPAddress WizFi360Class::localIP()
 {
 	IPAddress ret;
 	if(wizfi360Mode==1)
-		WizFi360Drv::getIpAddress(ret);
+		_drv->getIpAddress(ret);
 	else
-		WizFi360Drv::getIpAddressAP(ret);
+		_drv->getIpAddressAP(ret);
 	return ret;
 }
 
@@ -118,7 +120,7 @@ IPAddress WizFi360Class::subnetMask()
 {
 	IPAddress mask;
 	if(wizfi360Mode==1)
-    WizFi360Drv::getNetmask(mask);
+    _drv->getNetmask(mask);
 	return mask;
 }
 
@@ -126,54 +128,59 @@ IPAddress WizFi360Class::gatewayIP()
 {
 	IPAddress gw;
 	if(wizfi360Mode==1)
-		WizFi360Drv::getGateway(gw);
+		_drv->getGateway(gw);
 	return gw;
 }
 
 
 char* WizFi360Class::SSID()
 {
-    return WizFi360Drv::getCurrentSSID();
+    return _drv->getCurrentSSID();
 }
 
 uint8_t* WizFi360Class::BSSID(uint8_t* bssid)
 {
 	// TODO we don't need _bssid
-	uint8_t* _bssid = WizFi360Drv::getCurrentBSSID();
+	uint8_t* _bssid = _drv->getCurrentBSSID();
 	memcpy(bssid, _bssid, WL_MAC_ADDR_LENGTH);
     return bssid;
 }
 
 int32_t WizFi360Class::RSSI()
 {
-    return WizFi360Drv::getCurrentRSSI();
+    return _drv->getCurrentRSSI();
 }
 
 
 int8_t WizFi360Class::scanNetworks()
 {
-	return WizFi360Drv::getScanNetworks();
+	return _drv->getScanNetworks();
+}
+
+int WizFi360Class::scanNetworks(WizFi360ScanCallback callback, void* ctx, uint8_t maxResults)
+{
+	return _drv->scanNetworks(callback, ctx, maxResults);
 }
 
 char* WizFi360Class::SSID(uint8_t networkItem)
 {
-	return WizFi360Drv::getSSIDNetoworks(networkItem);
+	return _drv->getSSIDNetoworks(networkItem);
 }
 
 int32_t WizFi360Class::RSSI(uint8_t networkItem)
 {
-	return WizFi360Drv::getRSSINetoworks(networkItem);
+	return _drv->getRSSINetoworks(networkItem);
 }
 
 uint8_t WizFi360Class::encryptionType(uint8_t networkItem)
 {
-    return WizFi360Drv::getEncTypeNetowrks(networkItem);
+    return _drv->getEncTypeNetowrks(networkItem);
 }
 
 
 uint8_t WizFi360Class::status()
 {
-	return WizFi360Drv::getConnectionStatus();
+	return _drv->getConnectionStatus();
 }
 
 
@@ -184,7 +191,7 @@ uint8_t WizFi360Class::status()
 
 void WizFi360Class::reset(void)
 {
-	WizFi360Drv::reset();
+	_drv->reset();
 }
 
 
@@ -201,33 +208,79 @@ delay(WIZFI360_HARD_RESET_DURATION);
 */
 
 
+bool WizFi360Class::networkInfo(NetworkInfo& info, bool refresh)
+{
+	return _drv->getNetworkInfo(&info, refresh);
+}
+
+void WizFi360Class::setNetworkInfoTTL(unsigned long ttl)
+{
+	_drv->setNetworkInfoTTL(ttl);
+}
+
+unsigned long WizFi360Class::bootTime()
+{
+	return _drv->getBootTime();
+}
+
 bool WizFi360Class::ping(const char *host)
 {
-	return WizFi360Drv::ping(host);
+	return _drv->ping(host);
+}
+
+bool WizFi360Class::setBaudRate(unsigned long baud, unsigned long currentBaud, WizFi360BaudCallback setHostBaud, bool flowControl)
+{
+	return _drv->setBaudRate(baud, currentBaud, setHostBaud, flowControl);
 }
 
-uint8_t WizFi360Class::getFreeSocket()
+bool WizFi360Class::setSendWindow(uint8_t depth)
 {
-  // WizFi360 Module assigns socket numbers in ascending order, so we will assign them in descending order
-    for (int i = MAX_SOCK_NUM - 1; i >= 0; i--)
-	{
-      if (_state[i] == NA_STATE)
-      {
-          return i;
-      }
-    }
-    return SOCK_NOT_AVAIL;
+	return _drv->setSendWindow(depth);
 }
 
-void WizFi360Class::allocateSocket(uint8_t sock)
+void WizFi360Class::getTxCounters(unsigned long* sends, unsigned long* saved)
 {
-  _state[sock] = sock;
+	_drv->getTxCounters(sends, saved);
 }
 
-void WizFi360Class::releaseSocket(uint8_t sock)
+bool WizFi360Class::getStats(WizFi360Stats& stats)
 {
-  _state[sock] = NA_STATE;
+	return _drv->getStats(&stats);
 }
 
+void WizFi360Class::resetStats()
+{
+	_drv->resetStats();
+}
+
+void WizFi360Class::onReceive(WizFi360RecvCallback callback)
+{
+	_drv->setRecvCallback(callback);
+}
+
+void WizFi360Class::onEvent(WizFi360EventCallback callback)
+{
+	_drv->setEventCallback(callback);
+}
+
+bool WizFi360Class::sendCommand(const __FlashStringHelper* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx)
+{
+	return _drv->sendCmdAsync(cmd, timeout, callback, ctx);
+}
+
+bool WizFi360Class::sendCommand(const char* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx)
+{
+	return _drv->sendCmdAsync(cmd, timeout, callback, ctx);
+}
+
+void WizFi360Class::poll()
+{
+	_drv->poll();
+}
+
+bool WizFi360Class::commandPending()
+{
+	return _drv->cmdPending();
+}
 
 WizFi360Class WiFi;
@@ -29,32 +29,54 @@ along with The Arduino WizFi360 library.  If not, see
 #include "WizFi360Server.h"
 #include "utility/WizFi360Drv.h"
 #include "utility/RingBuffer.h"
+#include "utility/SerialRecorder.h"
 #include "utility/debug.h"
 
 
+/*
+ * The build flags changing the size of the library objects (see
+ * MAX_SOCK_NUM in WizFi360Drv.h) are checked at link time: the library
+ * defines a symbol named after the values it was compiled with, and init()
+ * references the one named after the values of the sketch. With different
+ * values the link fails on an undefined wizfi360_layout_... symbol.
+ */
+#define WIZFI360_LAYOUT_NAME(socks, rx, tx, stats, rec) wizfi360_layout_##socks##_##rx##_##tx##_##stats##_##rec
+#define WIZFI360_LAYOUT_SYMBOL(socks, rx, tx, stats, rec) WIZFI360_LAYOUT_NAME(socks, rx, tx, stats, rec)
+#define WIZFI360_LAYOUT WIZFI360_LAYOUT_SYMBOL(MAX_SOCK_NUM, SOCK_RX_BUFFER_SIZE, SOCK_TX_BUFFER_SIZE, WIZFI360_STATS, SERIAL_RECORDER_SIZE)
+
+extern const uint8_t WIZFI360_LAYOUT;
+
+
 class WizFi360Class
 {
 
 public:
 
-	static int16_t _state[MAX_SOCK_NUM];
-	static uint16_t _server_port[MAX_SOCK_NUM];
-
 	WizFi360Class();
 
+	/**
+	* Use another module than the default one, wizfi360Drv.
+	* The clients, servers and UDP sockets using it must be created with the
+	* same driver.
+	*/
+	WizFi360Class(WizFi360Drv& drv);
+
 
 	/**
 	* Initialize the WizFi360 module.
 	*
 	* param wizfi360Serial: the serial interface (HW or SW) used to communicate with the WizFi360 module
 	*/
-	static void init(Stream* wizfi360Serial);
+	void init(Stream* wizfi360Serial)
+	{
+		initModule(wizfi360Serial, &WIZFI360_LAYOUT);
+	}
 
 
 	/**
 	* Get firmware version
 	*/
-	static char* firmwareVersion();
+	char* firmwareVersion();
 
 
 	// NOT IMPLEMENTED
@@ -182,6 +204,19 @@ public:
      */
     int8_t scanNetworks();
 
+    /*
+     * Scan the networks and call the callback with each access point found,
+     * as soon as it is received. Nothing is stored, SSID(), RSSI() and
+     * encryptionType() are not updated.
+     *
+     * param callback: function receiving the SSID, RSSI and encryption type
+     * param ctx: pointer passed to the callback
+     * param maxResults: only pass the maxResults strongest networks, 0 for all
+     *
+     * return: Number of networks passed to the callback, -1 on error
+     */
+    int scanNetworks(WizFi360ScanCallback callback, void* ctx=NULL, uint8_t maxResults=0);
+
     /*
      * Return the SSID discovered during the network scan.
      *
@@ -251,22 +286,131 @@ public:
 	*/
 	void reset();
 
+	/**
+	* Get all the network settings of the station at once.
+	* They are kept for the time set by setNetworkInfoTTL (NETWORK_INFO_TTL
+	* by default) or until the WiFi connection changes, and they are used by
+	* localIP(), subnetMask(), gatewayIP(), macAddress(), SSID(), BSSID()
+	* and RSSI().
+	*
+	* param refresh: ask the module even if the settings are still valid
+	*
+	* return: false if the module did not answer
+	*/
+	bool networkInfo(NetworkInfo& info, bool refresh=false);
+
+	/**
+	* Set how long in ms the network settings are kept, 0 to ask the module
+	* each time.
+	*/
+	void setNetworkInfoTTL(unsigned long ttl);
+
+	/**
+	* Return the time in ms taken by init() to start the module.
+	*/
+	unsigned long bootTime();
+
 	/**
 	* Ping a host.
 	*/
 	bool ping(const char *host);
 
+	/**
+	* Change the baud rate of the UART link with the module.
+	* The module is configured with AT+UART_CUR, then setHostBaud is called
+	* to reconfigure the serial port of the board at the same rate.
+	* If the module does not answer at the new rate both sides go back to
+	* currentBaud.
+	*
+	* param baud: the new baud rate (up to 2000000)
+	* param currentBaud: the baud rate in use
+	* param setHostBaud: function changing the baud rate of the serial port
+	* param flowControl: enable the RTS/CTS hardware flow control, needed at
+	*		  high baud rates when the board cannot empty its receive buffer
+	*		  in time. The board must support it too.
+	*
+	* return: false if the baud rate was not changed
+	*/
+	bool setBaudRate(unsigned long baud, unsigned long currentBaud, WizFi360BaudCallback setHostBaud, bool flowControl=false);
+
+
+	/**
+	* Set the number of TCP segments which can be sent on a connection
+	* before waiting for their acknowledgement (AT+CIPSENDBUF).
+	* A depth of 0 or 1 waits for SEND OK after each write.
+	*
+	* return: false if the firmware does not support buffered sends
+	*/
+	bool setSendWindow(uint8_t depth);
+
+	/**
+	* Get the number of AT+CIPSEND issued for the data written by the
+	* clients and the number of writes merged in a previous AT+CIPSEND.
+	*/
+	void getTxCounters(unsigned long* sends, unsigned long* saved);
+
+	/**
+	* Get the statistics of the driver: AT commands and their latency by type,
+	* bytes exchanged with the module and by connection, timeouts, send
+	* failures and unexpected data discarded.
+	* They are collected only if the library is compiled with WIZFI360_STATS
+	* defined to 1.
+	*
+	* return: false if the statistics are not collected
+	*/
+	bool getStats(WizFi360Stats& stats);
+	void resetStats();
+
+
+	/**
+	* Register a function called with the data received on every link as soon
+	* as it is read from the module, without copy to the receive buffers.
+	* WiFiClient::available() and read() do not return this data.
+	* Set it before opening the links: the module is switched from keeping
+	* the data until it is read to sending it as it arrives.
+	* The callback is called during the library calls (poll(), connected(),
+	* ...) and must not call the library itself. NULL removes it.
+	*/
+	void onReceive(WizFi360RecvCallback callback);
+
+	/**
+	* Register a function called with the notifications of the module
+	* (EVENT_WIFI_GOT_IP, EVENT_LINK_CLOSED, ...) as soon as they are
+	* received, even in the middle of the response of a command.
+	* Like the receive callback it must not call the library. NULL removes it.
+	*/
+	void onEvent(WizFi360EventCallback callback);
+
+
+	/**
+	* Queue an AT command without waiting for the response.
+	* The callback is called by poll() with the tag terminating the response
+	* (TAG_OK, TAG_ERROR, ...) or -1 on timeout.
+	* The command string must stay valid until the callback is called.
+	*
+	* return: false if the command queue is full
+	*/
+	bool sendCommand(const __FlashStringHelper* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx=NULL);
+	bool sendCommand(const char* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx=NULL);
+
+	/**
+	* Process the queued AT commands without blocking.
+	* Call it from loop() when using sendCommand.
+	*/
+	void poll();
+
+	/**
+	* Return true while queued AT commands are not completed.
+	*/
+	bool commandPending();
 
-	friend class WiFiClient;
-	friend class WiFiServer;
-	friend class WiFiUDP;
 
 private:
-	static uint8_t getFreeSocket();
-	static void allocateSocket(uint8_t sock);
-	static void releaseSocket(uint8_t sock);
+	void initModule(Stream* wizfi360Serial, const uint8_t* layout);
+
+	WizFi360Drv* _drv;
 
-	static uint8_t wizfi360Mode;
+	uint8_t wizfi360Mode;
 };
 
 extern WizFi360Class WiFi;
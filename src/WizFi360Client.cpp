@@ -26,11 +26,15 @@ along with The Arduino WizFi360 library.  If not, see
 #include "utility/debug.h"
 
 
-WiFiClient::WiFiClient() : _sock(255)
+WiFiClient::WiFiClient() : _drv(&wizfi360Drv), _sock(255), _transparent(false)
 {
 }
 
-WiFiClient::WiFiClient(uint8_t sock) : _sock(sock)
+WiFiClient::WiFiClient(uint8_t sock) : _drv(&wizfi360Drv), _sock(sock), _transparent(false)
+{
+}
+
+WiFiClient::WiFiClient(WizFi360Drv& drv, uint8_t sock) : _drv(&drv), _sock(sock), _transparent(false)
 {
 }
 
@@ -70,6 +74,33 @@ int WiFiClient::connectSSL(IPAddress ip, uint16_t port)
 	return connect(s, port, SSL_MODE);
 }
 
+int WiFiClient::connectTransparent(IPAddress ip, uint16_t port)
+{
+	char s[16];
+	sprintf_P(s, PSTR("%d.%d.%d.%d"), ip[0], ip[1], ip[2], ip[3]);
+	return connectTransparent(s, port);
+}
+
+int WiFiClient::connectTransparent(const char* host, uint16_t port, bool ssl)
+{
+	LOGINFO1(F("Connecting in transparent mode to"), host);
+
+	// the single connection has no link ID, socket 0 is reserved for it
+	if (_drv->socketAllocated(0))
+	{
+		LOGERROR(F("No socket available"));
+		return 0;
+	}
+
+	if (!_drv->startTransparent(host, port, ssl ? SSL_MODE : TCP_MODE))
+		return 0;
+
+	_sock = 0;
+	_transparent = true;
+	_drv->allocateSocket(_sock);
+	return 1;
+}
+
 int WiFiClient::connect(const char* host, uint16_t port)
 {
     return connect(host, port, TCP_MODE);
@@ -88,14 +119,14 @@ int WiFiClient::connect(const char* host, uint16_t port, uint8_t protMode)
 {
 	LOGINFO1(F("Connecting to"), host);
 
-	_sock = WizFi360Class::getFreeSocket();
+	_sock = _drv->getFreeSocket();
 
     if (_sock != NO_SOCKET_AVAIL)
     {
-    	if (!WizFi360Drv::startClient(host, port, _sock, protMode))
+    	if (!_drv->startClient(host, port, _sock, protMode))
 			return 0;
 
-    	WizFi360Class::allocateSocket(_sock);
+    	_drv->allocateSocket(_sock);
     }
 	else
 	{
@@ -114,13 +145,40 @@ size_t WiFiClient::write(uint8_t b)
 
 size_t WiFiClient::write(const uint8_t *buf, size_t size)
 {
+	if (_transparent)
+		return _drv->sendTransparent(buf, size);
+
 	if (_sock >= MAX_SOCK_NUM or size==0)
 	{
 		setWriteError();
 		return 0;
 	}
 
-	bool r = WizFi360Drv::sendData(_sock, buf, size);
+	bool r = _drv->writeData(_sock, buf, size);
+	if (!r)
+	{
+		setWriteError();
+		LOGERROR1(F("Failed to write to socket"), _sock);
+		delay(4000);
+		stop();
+		return 0;
+	}
+
+	return size;
+}
+
+size_t WiFiClient::writev(const DataFragment* frags, uint8_t count)
+{
+	if (_transparent)
+		return _drv->sendTransparent(frags, count);
+
+	if (_sock >= MAX_SOCK_NUM or count==0)
+	{
+		setWriteError();
+		return 0;
+	}
+
+	bool r = _drv->writeData(_sock, frags, count);
 	if (!r)
 	{
 		setWriteError();
@@ -130,6 +188,9 @@ size_t WiFiClient::write(const uint8_t *buf, size_t size)
 		return 0;
 	}
 
+	size_t size = 0;
+	for (uint8_t i = 0; i < count; i++)
+		size += frags[i].len;
 	return size;
 }
 
@@ -137,9 +198,12 @@ size_t WiFiClient::write(const uint8_t *buf, size_t size)
 
 int WiFiClient::available()
 {
+	if (_transparent)
+		return _drv->availTransparent();
+
 	if (_sock != 255)
 	{
-		int bytes = WizFi360Drv::availData(_sock);
+		int bytes = _drv->availData(_sock);
 		if (bytes>0)
 		{
 			return bytes;
@@ -155,12 +219,18 @@ int WiFiClient::read()
 	if (!available())
 		return -1;
 
+	if (_transparent)
+	{
+		_drv->getTransparent(&b, 1);
+		return b;
+	}
+
 	bool connClose = false;
-	WizFi360Drv::getData(_sock, &b, false, &connClose);
+	_drv->getData(_sock, &b, false, &connClose);
 
 	if (connClose)
 	{
-		WizFi360Class::releaseSocket(_sock);
+		_drv->releaseSocket(_sock);
 		_sock = 255;
 	}
 
@@ -171,7 +241,9 @@ int WiFiClient::read(uint8_t* buf, size_t size)
 {
 	if (!available())
 		return -1;
-	return WizFi360Drv::getDataBuf(_sock, buf, size);
+	if (_transparent)
+		return _drv->getTransparent(buf, size);
+	return _drv->getDataBuf(_sock, buf, size);
 }
 
 int WiFiClient::peek()
@@ -180,12 +252,15 @@ int WiFiClient::peek()
 	if (!available())
 		return -1;
 
+	if (_transparent)
+		return _drv->peekTransparent();
+
 	bool connClose = false;
-	WizFi360Drv::getData(_sock, &b, true, &connClose);
+	_drv->getData(_sock, &b, true, &connClose);
 
 	if (connClose)
 	{
-		WizFi360Class::releaseSocket(_sock);
+		_drv->releaseSocket(_sock);
 		_sock = 255;
 	}
 
@@ -195,8 +270,8 @@ int WiFiClient::peek()
 
 void WiFiClient::flush()
 {
-	while (available())
-		read();
+	if (!_transparent)
+		_drv->flushData(_sock);
 }
 
 
@@ -208,9 +283,17 @@ void WiFiClient::stop()
 
 	LOGINFO1(F("Disconnecting "), _sock);
 
-	WizFi360Drv::stopClient(_sock);
+	if (_transparent)
+	{
+		_drv->stopTransparent();
+		_transparent = false;
+	}
+	else
+	{
+		_drv->stopClient(_sock);
+	}
 
-	WizFi360Class::releaseSocket(_sock);
+	_drv->releaseSocket(_sock);
 	_sock = 255;
 }
 
@@ -239,17 +322,23 @@ uint8_t WiFiClient::status()
 		return CLOSED;
 	}
 
-	if (WizFi360Drv::availData(_sock))
+	// the module does not report the state of the transparent connection
+	if (_transparent)
+	{
+		return ESTABLISHED;
+	}
+
+	if (_drv->availData(_sock))
 	{
 		return ESTABLISHED;
 	}
 
-	if (WizFi360Drv::getClientState(_sock))
+	if (_drv->getClientState(_sock))
 	{
 		return ESTABLISHED;
 	}
 
-	WizFi360Class::releaseSocket(_sock);
+	_drv->releaseSocket(_sock);
 	_sock = 255;
 
 	return CLOSED;
@@ -258,7 +347,7 @@ uint8_t WiFiClient::status()
 IPAddress WiFiClient::remoteIP()
 {
 	IPAddress ret;
-	WizFi360Drv::getRemoteIpAddress(ret);
+	_drv->getRemoteIpAddress(ret);
 	return ret;
 }
 
@@ -269,14 +358,34 @@ IPAddress WiFiClient::remoteIP()
 size_t WiFiClient::printFSH(const __FlashStringHelper *ifsh, bool appendCrLf)
 {
 	size_t size = strlen_P((char*)ifsh);
-	
+
+	if (_transparent)
+	{
+		// copy the string from flash by chunks
+		uint8_t buf[32];
+		PGM_P p = reinterpret_cast<PGM_P>(ifsh);
+		size_t n = 0;
+		while (n < size)
+		{
+			size_t len = size - n;
+			if (len > sizeof(buf))
+				len = sizeof(buf);
+			memcpy_P(buf, p + n, len);
+			_drv->sendTransparent(buf, len);
+			n += len;
+		}
+		if (appendCrLf)
+			_drv->sendTransparent((const uint8_t*)"\r\n", 2);
+		return size;
+	}
+
 	if (_sock >= MAX_SOCK_NUM or size==0)
 	{
 		setWriteError();
 		return 0;
 	}
 
-	bool r = WizFi360Drv::sendData(_sock, ifsh, size, appendCrLf);
+	bool r = _drv->writeData(_sock, ifsh, size, appendCrLf);
 	if (!r)
 	{
 		setWriteError();
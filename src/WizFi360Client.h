@@ -25,6 +25,7 @@ along with The Arduino WizFi360 library.  If not, see
 #include "Client.h"
 #include "IPAddress.h"
 
+#include "utility/WizFi360Drv.h"
 
 
 class WiFiClient : public Client
@@ -32,6 +33,11 @@ class WiFiClient : public Client
 public:
   WiFiClient();
   WiFiClient(uint8_t sock);
+
+  /*
+  * Client of another module than the default one
+  */
+  WiFiClient(WizFi360Drv& drv, uint8_t sock=255);
   
   
   // override Print.print method
@@ -63,9 +69,19 @@ public:
   * Returns true if the connection succeeds, false if not.
   */
   int connectSSL(const char* host, uint16_t port);
+
+  /*
+  * Connect to the specified host and port in transparent transmission mode.
+  * The data is exchanged without AT framing for the highest throughput, but
+  * no other connection or WiFi function can be used until stop() is called.
+  * Returns true if the connection succeeds, false if not.
+  */
+  int connectTransparent(IPAddress ip, uint16_t port);
+  int connectTransparent(const char* host, uint16_t port, bool ssl=false);
   
   /*
   * Write a character to the server the client is connected to.
+  * The small writes are buffered and sent together, see SOCK_TX_BUFFER_SIZE.
   * Returns the number of characters written.
   */
   virtual size_t write(uint8_t);
@@ -76,6 +92,13 @@ public:
   */
   virtual size_t write(const uint8_t *buf, size_t size);
 
+  /*
+  * Write several buffers, in RAM or in flash, with a single AT+CIPSEND.
+  * The fragments are built with dataFragment(), see WizFi360Drv.h.
+  * Returns the number of characters written.
+  */
+  size_t writev(const DataFragment* frags, uint8_t count);
+
 
   virtual int available();
 
@@ -94,7 +117,8 @@ public:
   virtual int peek();
 
   /*
-  * Discard any bytes that have been written to the client but not yet read.
+  * Send the data buffered by write(). The bytes received but not yet read
+  * stay available.
   */
   virtual void flush();
 
@@ -133,7 +157,9 @@ public:
 
 private:
 
+  WizFi360Drv* _drv;
   uint8_t _sock;     // connection id
+  bool _transparent; // transparent transmission mode
 
   int connect(const char* host, uint16_t port, uint8_t protMode);
   
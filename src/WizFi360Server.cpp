@@ -25,6 +25,13 @@ along with The Arduino WizFi360 library.  If not, see
 
 WiFiServer::WiFiServer(uint16_t port)
 {
+	_drv = &wizfi360Drv;
+	_port = port;
+}
+
+WiFiServer::WiFiServer(WizFi360Drv& drv, uint16_t port)
+{
+	_drv = &drv;
 	_port = port;
 }
 
@@ -34,7 +41,7 @@ void WiFiServer::begin()
 
 	/* The WizFi360 Module only allows socket 1 to be used for the server */
 #if 0
-	_sock = WizFi360Class::getFreeSocket();
+	_sock = _drv->getFreeSocket();
 	if (_sock == SOCK_NOT_AVAIL)
 	  {
 	    LOGERROR(F("No socket available for server"));
@@ -43,9 +50,9 @@ void WiFiServer::begin()
 #else
 	_sock = 1; // If this is already in use, the startServer attempt will fail
 #endif
-	WizFi360Class::allocateSocket(_sock);
+	_drv->allocateSocket(_sock);
 
-	_started = WizFi360Drv::startServer(_port, _sock);
+	_started = _drv->startServer(_port, _sock);
 
 	if (_started)
 	{
@@ -61,21 +68,21 @@ WiFiClient WiFiServer::available(byte* status)
 {
 	// TODO the original method seems to handle automatic server restart
 
-	int bytes = WizFi360Drv::availData(0);
-	if (bytes>0)
+	uint8_t sock = _drv->getServerLink();
+	if (sock!=NO_SOCKET_AVAIL)
 	{
-		LOGINFO1(F("New client"), WizFi360Drv::_connId);
-		WizFi360Class::allocateSocket(WizFi360Drv::_connId);
-		WiFiClient client(WizFi360Drv::_connId);
+		LOGINFO1(F("New client"), sock);
+		_drv->allocateSocket(sock);
+		WiFiClient client(*_drv, sock);
 		return client;
 	}
 
-    return WiFiClient(255);
+    return WiFiClient(*_drv);
 }
 
 uint8_t WiFiServer::status()
 {
-    return WizFi360Drv::getServerState(0);
+    return _drv->getServerState(0);
 }
 
 size_t WiFiServer::write(uint8_t b)
@@ -89,9 +96,9 @@ size_t WiFiServer::write(const uint8_t *buffer, size_t size)
 
     for (int sock = 0; sock < MAX_SOCK_NUM; sock++)
     {
-        if (WizFi360Class::_state[sock] != 0)
+        if (_drv->socketAllocated(sock))
         {
-        	WiFiClient client(sock);
+        	WiFiClient client(*_drv, sock);
             n += client.write(buffer, size);
         }
     }
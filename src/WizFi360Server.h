@@ -32,6 +32,11 @@ class WiFiServer : public Server
 public:
 	WiFiServer(uint16_t port);
 
+	/*
+	* Server of another module than the default one
+	*/
+	WiFiServer(WizFi360Drv& drv, uint16_t port);
+
 
 	/*
 	* Gets a client that is connected to the server and has data available for reading.
@@ -54,6 +59,7 @@ public:
 
 
 private:
+	WizFi360Drv* _drv;
 	uint16_t _port;
 	uint8_t _sock;
 	bool _started;
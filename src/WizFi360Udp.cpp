@@ -23,7 +23,9 @@ along with The Arduino WizFi360 library.  If not, see
 #include "utility/debug.h"
 
 /* Constructor */
-WiFiUDP::WiFiUDP() : _sock(NO_SOCKET_AVAIL) {}
+WiFiUDP::WiFiUDP() : _drv(&wizfi360Drv), _sock(NO_SOCKET_AVAIL) {}
+
+WiFiUDP::WiFiUDP(WizFi360Drv& drv) : _drv(&drv), _sock(NO_SOCKET_AVAIL) {}
 
 
 
@@ -32,13 +34,12 @@ WiFiUDP::WiFiUDP() : _sock(NO_SOCKET_AVAIL) {}
 
 uint8_t WiFiUDP::begin(uint16_t port)
 {
-    uint8_t sock = WizFi360Class::getFreeSocket();
+    uint8_t sock = _drv->getFreeSocket();
     if (sock != NO_SOCKET_AVAIL)
     {
-        WizFi360Drv::startClient("0", port, sock, UDP_MODE);
+        _drv->startClient("0", port, sock, UDP_MODE);
 		
-        WizFi360Class::allocateSocket(sock);  // allocating the socket for the listener
-        WizFi360Class::_server_port[sock] = port;
+        _drv->allocateSocket(sock);  // allocating the socket for the listener
         _sock = sock;
         _port = port;
         return 1;
@@ -54,7 +55,7 @@ int WiFiUDP::available()
 {
 	 if (_sock != NO_SOCKET_AVAIL)
 	 {
-		int bytes = WizFi360Drv::availData(_sock);
+		int bytes = _drv->availData(_sock);
 		if (bytes>0)
 		{
 			return bytes;
@@ -74,9 +75,8 @@ void WiFiUDP::stop()
       flush();
       
       // Stop the listener and return the socket to the pool
-	  WizFi360Drv::stopClient(_sock);
-      WizFi360Class::_state[_sock] = NA_STATE;
-      WizFi360Class::_server_port[_sock] = 0;
+	  _drv->stopClient(_sock);
+      _drv->releaseSocket(_sock);
 
 	  _sock = NO_SOCKET_AVAIL;
 }
@@ -84,13 +84,13 @@ void WiFiUDP::stop()
 int WiFiUDP::beginPacket(const char *host, uint16_t port)
 {
   if (_sock == NO_SOCKET_AVAIL)
-	  _sock = WizFi360Class::getFreeSocket();
+	  _sock = _drv->getFreeSocket();
   if (_sock != NO_SOCKET_AVAIL)
   {
 	  //WizFi360Drv::startClient(host, port, _sock, UDP_MODE);
 	  _remotePort = port;
 	  strcpy(_remoteHost, host);
-	  WizFi360Class::allocateSocket(_sock);
+	  _drv->allocateSocket(_sock);
 	  return 1;
   }
   return 0;
@@ -118,12 +118,26 @@ size_t WiFiUDP::write(uint8_t byte)
 
 size_t WiFiUDP::write(const uint8_t *buffer, size_t size)
 {
-	bool r = WizFi360Drv::sendDataUdp(_sock, _remoteHost, _remotePort, buffer, size);
+	bool r = _drv->sendDataUdp(_sock, _remoteHost, _remotePort, buffer, size);
+	if (!r)
+	{
+		return 0;
+	}
+
+	return size;
+}
+
+size_t WiFiUDP::writev(const DataFragment* frags, uint8_t count)
+{
+	bool r = _drv->sendDataUdp(_sock, _remoteHost, _remotePort, frags, count);
 	if (!r)
 	{
 		return 0;
 	}
 
+	size_t size = 0;
+	for (uint8_t i = 0; i < count; i++)
+		size += frags[i].len;
 	return size;
 }
 
@@ -141,7 +155,7 @@ int WiFiUDP::read()
 	bool connClose = false;
 	
     // Read the data and handle the timeout condition
-	if (! WizFi360Drv::getData(_sock, &b, false, &connClose))
+	if (! _drv->getData(_sock, &b, false, &connClose))
       return -1;  // Timeout occurred
 
 	return b;
@@ -151,7 +165,7 @@ int WiFiUDP::read(uint8_t* buf, size_t size)
 {
 	if (!available())
 		return -1;
-	return WizFi360Drv::getDataBuf(_sock, buf, size);
+	return _drv->getDataBuf(_sock, buf, size);
 }
 
 int WiFiUDP::peek()
@@ -175,13 +189,13 @@ void WiFiUDP::flush()
 IPAddress  WiFiUDP::remoteIP()
 {
 	IPAddress ret;
-	WizFi360Drv::getRemoteIpAddress(ret);
+	_drv->getRemoteIpAddress(ret);
 	return ret;
 }
 
 uint16_t  WiFiUDP::remotePort()
 {
-	return WizFi360Drv::getRemotePort();
+	return _drv->getRemotePort();
 }
 
 
@@ -21,10 +21,13 @@ along with The Arduino WizFi360 library.  If not, see
 
 #include <Udp.h>
 
+#include "utility/WizFi360Drv.h"
+
 #define UDP_TX_PACKET_MAX_SIZE 24
 
 class WiFiUDP : public UDP {
 private:
+  WizFi360Drv* _drv;
   uint8_t _sock;  // socket ID for Wiz5100
   uint16_t _port; // local port to listen on
   
@@ -35,6 +38,7 @@ private:
 
 public:
   WiFiUDP();  // Constructor
+  WiFiUDP(WizFi360Drv& drv);  // UDP socket of another module than the default one
 
   virtual uint8_t begin(uint16_t);	// initialize, start listening on specified port. Returns 1 if successful, 0 if there are no sockets available to use
   virtual void stop();  // Finish with the UDP socket
@@ -58,6 +62,8 @@ public:
 
   // Write size bytes from buffer into the packet
   virtual size_t write(const uint8_t *buffer, size_t size);
+  // Send the fragments, in RAM or in flash, as a single datagram of at most MAX_SEND_SIZE bytes
+  size_t writev(const DataFragment* frags, uint8_t count);
 
   using Print::write;
 
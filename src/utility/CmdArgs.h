@@ -0,0 +1,68 @@
+/*--------------------------------------------------------------------
+This file is part of the Arduino WizFi360 library.
+
+The Arduino WizFi360 library is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The Arduino WizFi360 library is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with The Arduino WizFi360 library.  If not, see
+<http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------*/
+
+#ifndef _CMDARGS_H_
+#define _CMDARGS_H_
+
+#include <Print.h>
+
+
+/*
+ * Arguments of an AT command, printed one after the other after the command
+ * string. Their types are known at compile time, each one is printed with
+ * the matching Print::print so the command is streamed to the serial
+ * interface without being formatted in a buffer.
+ *
+ * Example: AT+CIPCLOSE=<link ID>,<port>
+ *   CmdArgs<uint8_t, const __FlashStringHelper*, uint16_t> args(sock, F(","), port);
+ */
+template<typename... Args>
+struct CmdArgs;
+
+template<>
+struct CmdArgs<>
+{
+	size_t print(Print*) const { return 0; }
+};
+
+template<typename T, typename... Rest>
+struct CmdArgs<T, Rest...>
+{
+	T first;
+	CmdArgs<Rest...> rest;
+
+	CmdArgs(T f, Rest... r) : first(f), rest(r...) {}
+
+	size_t print(Print* out) const
+	{
+		size_t n = out->print(first);
+		return n + rest.print(out);
+	}
+};
+
+
+/*
+ * Print arguments stored without their type, see AtCommand
+ */
+template<typename... Args>
+size_t printCmdArgs(Print* out, const void* args)
+{
+	return static_cast<const CmdArgs<Args...>*>(args)->print(out);
+}
+
+#endif
@@ -19,29 +19,152 @@ along with The Arduino WizFi360 library.  If not, see
 #ifndef _RINGBUFFER_H_
 #define _RINGBUFFER_H_
 
+#include <inttypes.h>
+#include <string.h>
 
+
+/*
+ * Circular buffer of N bytes, N being a power of two so the positions wrap
+ * with a mask. The storage is part of the object, no memory is allocated.
+ *
+ * It is used as a FIFO (push/read) or to keep the last N bytes received
+ * (pushOver), the bytes being always read from the oldest one.
+ */
+template<unsigned int N>
 class RingBuffer
 {
+	static_assert(N>0 and (N & (N-1))==0, "RingBuffer size must be a power of two");
+
 public:
-	RingBuffer(unsigned int size);
-	~RingBuffer();
+	RingBuffer() { clear(); }
+
+	void clear()
+	{
+		_head = 0;
+		_count = 0;
+	}
+
+	unsigned int available() const { return _count; }
+	unsigned int room() const { return N - _count; }
+
+	// Add a byte, returns false if the buffer is full
+	bool push(uint8_t c)
+	{
+		if (_count>=N)
+			return false;
+
+		_buf[(_head+_count) & MASK] = c;
+		_count++;
+		return true;
+	}
+
+	// Add a byte, dropping the oldest one if the buffer is full
+	void pushOver(uint8_t c)
+	{
+		_buf[(_head+_count) & MASK] = c;
+		if (_count<N)
+			_count++;
+		else
+			_head = (_head+1) & MASK;
+	}
+
+	// Add up to len bytes, returns the number of bytes added
+	unsigned int push(const uint8_t* buf, unsigned int len)
+	{
+		if (len>room())
+			len = room();
+
+		// copy up to the end of the storage, then from its start
+		unsigned int tail = (_head+_count) & MASK;
+		unsigned int n = N - tail;
+		if (n>len)
+			n = len;
+		memcpy(&_buf[tail], buf, n);
+		memcpy(_buf, buf+n, len-n);
+
+		_count += len;
+		return len;
+	}
+
+	int read()
+	{
+		if (_count==0)
+			return -1;
 
-	void reset();
-	void init();
-	void push(char c);
-	int getPos();
-	bool endsWith(const char* str);
-	void getStr(char * destination, unsigned int skipChars);
-	void getStrN(char * destination, unsigned int skipChars, unsigned int num);
+		uint8_t c = _buf[_head];
+		_head = (_head+1) & MASK;
+		_count--;
+		return c;
+	}
+
+	int peek() const
+	{
+		if (_count==0)
+			return -1;
+
+		return _buf[_head];
+	}
+
+	// Remove up to size bytes, returns the number of bytes copied to buf
+	unsigned int read(uint8_t* buf, unsigned int size)
+	{
+		size = copy(buf, size);
+		_head = (_head+size) & MASK;
+		_count -= size;
+		return size;
+	}
+
+	// True if the last bytes added are str
+	bool endsWith(const char* str) const
+	{
+		unsigned int len = strlen(str);
+		if (len>_count)
+			return false;
+
+		unsigned int pos = _head + _count - len;
+		for (unsigned int i=0; i<len; i++)
+		{
+			if (_buf[(pos+i) & MASK] != (uint8_t)str[i])
+				return false;
+		}
+		return true;
+	}
+
+	// Copy at most num bytes as a string, without the last skipChars bytes.
+	// destination must hold num+1 characters.
+	void getStrN(char* destination, unsigned int skipChars, unsigned int num) const
+	{
+		unsigned int len = _count>skipChars ? _count-skipChars : 0;
+		if (len>num)
+			len = num;
+
+		copy((uint8_t*)destination, len);
+		destination[len] = 0;
+	}
 
 
 private:
 
-	unsigned int _size;
-	char* ringBuf;
-	char* ringBufEnd;
-	char* ringBufP;
+	static const unsigned int MASK = N-1;
+
+	// Copy up to size bytes from the oldest one
+	unsigned int copy(uint8_t* buf, unsigned int size) const
+	{
+		if (size>_count)
+			size = _count;
+
+		unsigned int n = N - _head;
+		if (n>size)
+			n = size;
+		memcpy(buf, &_buf[_head], n);
+		memcpy(buf+n, _buf, size-n);
+		return size;
+	}
+
+	uint8_t _buf[N];
+	unsigned int _head;
+	unsigned int _count;
 
 };
 
-#endif
\ No newline at end of file
+#endif
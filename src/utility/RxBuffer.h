@@ -0,0 +1,44 @@
+/*--------------------------------------------------------------------
+This file is part of the Arduino WizFi360 library.
+
+The Arduino WizFi360 library is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The Arduino WizFi360 library is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with The Arduino WizFi360 library.  If not, see
+<http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------*/
+
+#ifndef _RXBUFFER_H_
+#define _RXBUFFER_H_
+
+#include "RingBuffer.h"
+
+// Size of the receive buffer of each socket, a power of two (build flag,
+// see MAX_SOCK_NUM)
+// The module keeps the TCP data until the buffer has room for it
+// (AT+CIPRECVMODE=1). The data sent as it arrives (UDP, receive callback or
+// firmware without the passive mode) is dropped if it does not fit while
+// an AT command is running, and its link is closed.
+#ifndef SOCK_RX_BUFFER_SIZE
+#if defined(__AVR__)
+#define SOCK_RX_BUFFER_SIZE 128
+#else
+#define SOCK_RX_BUFFER_SIZE 1024
+#endif
+#endif
+
+
+/*
+ * FIFO holding the data received on a socket
+ */
+typedef RingBuffer<SOCK_RX_BUFFER_SIZE> RxBuffer;
+
+#endif
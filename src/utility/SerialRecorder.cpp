@@ -0,0 +1,176 @@
+/*--------------------------------------------------------------------
+This file is part of the Arduino WizFi360 library.
+
+The Arduino WizFi360 library is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The Arduino WizFi360 library is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with The Arduino WizFi360 library.  If not, see
+<http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------*/
+
+#include <Arduino.h>
+
+#include "utility/SerialRecorder.h"
+
+#define RECORD_TX       0x80
+#define RECORD_MAX_LEN  0x7F
+#define RECORD_HEADER   3
+
+static_assert(SERIAL_RECORDER_SIZE>RECORD_HEADER, "SERIAL_RECORDER_SIZE too small for a record");
+
+
+SerialRecorder::SerialRecorder(Stream* serial)
+{
+	_serial = serial;
+	_paused = false;
+	clear();
+}
+
+void SerialRecorder::clear()
+{
+	_head = 0;
+	_count = 0;
+	_last = 0;
+	_headTime = 0;
+	_lastTime = 0;
+}
+
+void SerialRecorder::dump(Print* out)
+{
+	unsigned int pos = 0;
+	unsigned long time = _headTime;
+
+	while (pos<_count)
+	{
+		uint8_t header = at(pos);
+		uint8_t len = header & RECORD_MAX_LEN;
+
+		if (pos>0)
+			time += (uint16_t)(at(pos+1) | (at(pos+2) << 8));
+
+		out->print(time);
+		out->print((header & RECORD_TX) ? F(" > ") : F(" < "));
+		for (uint8_t i=0; i<len; i++)
+		{
+			uint8_t c = at(pos+RECORD_HEADER+i);
+			if (c<0x10)
+				out->print('0');
+			out->print(c, HEX);
+		}
+		out->println();
+
+		pos += RECORD_HEADER + len;
+	}
+}
+
+
+int SerialRecorder::available()
+{
+	return _serial->available();
+}
+
+int SerialRecorder::read()
+{
+	int c = _serial->read();
+	if (c>=0)
+		record(c, false);
+	return c;
+}
+
+int SerialRecorder::peek()
+{
+	return _serial->peek();
+}
+
+void SerialRecorder::flush()
+{
+	_serial->flush();
+}
+
+size_t SerialRecorder::write(uint8_t c)
+{
+	record(c, true);
+	return _serial->write(c);
+}
+
+size_t SerialRecorder::write(const uint8_t *buf, size_t size)
+{
+	for (size_t i=0; i<size; i++)
+		record(buf[i], true);
+	return _serial->write(buf, size);
+}
+
+
+// Append a byte to the last record, or start a new one when the direction
+// or the time changes
+void SerialRecorder::record(uint8_t c, bool tx)
+{
+	if (_paused)
+		return;
+
+	unsigned long now = millis();
+
+	if (_count>0)
+	{
+		uint8_t header = _buf[_last];
+		if (((header & RECORD_TX)!=0)==tx and (header & RECORD_MAX_LEN)<RECORD_MAX_LEN and now==_lastTime)
+		{
+			while (_count+1 > SERIAL_RECORDER_SIZE)
+				dropRecord();
+
+			// the last record is dropped only if it was the only one
+			if (_count>0)
+			{
+				_buf[(_head+_count) % SERIAL_RECORDER_SIZE] = c;
+				_buf[_last]++;
+				_count++;
+				return;
+			}
+		}
+	}
+
+	while (_count+RECORD_HEADER+1 > SERIAL_RECORDER_SIZE)
+		dropRecord();
+
+	unsigned long delta = 0;
+	if (_count==0)
+		_headTime = now;
+	else
+		delta = now - _lastTime;
+	if (delta>0xFFFF)
+		delta = 0xFFFF;
+
+	_last = (_head+_count) % SERIAL_RECORDER_SIZE;
+	_buf[_last] = (tx ? RECORD_TX : 0) | 1;
+	_buf[(_last+1) % SERIAL_RECORDER_SIZE] = delta & 0xFF;
+	_buf[(_last+2) % SERIAL_RECORDER_SIZE] = delta >> 8;
+	_buf[(_last+3) % SERIAL_RECORDER_SIZE] = c;
+	_count += RECORD_HEADER+1;
+	_lastTime = now;
+}
+
+// Byte at a position from the start of the transcript
+uint8_t SerialRecorder::at(unsigned int pos)
+{
+	return _buf[(_head+pos) % SERIAL_RECORDER_SIZE];
+}
+
+void SerialRecorder::dropRecord()
+{
+	unsigned int size = RECORD_HEADER + (_buf[_head] & RECORD_MAX_LEN);
+
+	_head = (_head+size) % SERIAL_RECORDER_SIZE;
+	_count -= size;
+
+	// the time of the next record is relative to the dropped one
+	if (_count>0)
+		_headTime += (uint16_t)(at(1) | (at(2) << 8));
+}
@@ -0,0 +1,89 @@
+/*--------------------------------------------------------------------
+This file is part of the Arduino WizFi360 library.
+
+The Arduino WizFi360 library is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The Arduino WizFi360 library is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with The Arduino WizFi360 library.  If not, see
+<http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------*/
+
+#ifndef _SERIALRECORDER_H_
+#define _SERIALRECORDER_H_
+
+#include <Stream.h>
+
+// Size of the transcript kept by SerialRecorder (build flag, see MAX_SOCK_NUM
+// in WizFi360Drv.h)
+#ifndef SERIAL_RECORDER_SIZE
+#define SERIAL_RECORDER_SIZE 256
+#endif
+
+
+/*
+ * Stream passed to WiFi.init() in place of the serial port of the module,
+ * keeping a transcript of the bytes exchanged with their time.
+ * The oldest records are overwritten when the transcript is full.
+ *
+ * Each record is a header byte (bit 7 set for the bytes sent to the module,
+ * bits 0-6 the number of bytes), the time in ms since the previous record
+ * on 2 bytes, then the bytes.
+ *
+ * Example:
+ *   SerialRecorder recorder(&Serial1);
+ *   WiFi.init(&recorder);
+ *   ...
+ *   recorder.dump(&Serial);
+ *
+ * The output of dump() can be replayed to the driver on a PC, see
+ * extras/host/Replay.h.
+ */
+class SerialRecorder : public Stream
+{
+public:
+	SerialRecorder(Stream* serial);
+
+	/*
+	 * Print the transcript, one record per line: <time in ms> <'<' or '>'> <bytes in hex>
+	 * '>' is used for the bytes sent to the module.
+	 */
+	void dump(Print* out);
+	void clear();
+
+	void pause(bool paused) { _paused = paused; }
+
+	virtual int available();
+	virtual int read();
+	virtual int peek();
+	virtual void flush();
+	virtual size_t write(uint8_t c);
+	virtual size_t write(const uint8_t *buf, size_t size);
+	using Print::write;
+
+
+private:
+
+	void record(uint8_t c, bool tx);
+	uint8_t at(unsigned int pos);
+	void dropRecord();
+
+	Stream* _serial;
+	bool _paused;
+
+	uint8_t _buf[SERIAL_RECORDER_SIZE];
+	unsigned int _head;       // start of the oldest record
+	unsigned int _count;      // bytes used
+	unsigned int _last;       // header of the last record
+	unsigned long _headTime;  // time of the oldest record
+	unsigned long _lastTime;  // time of the last record
+};
+
+#endif
@@ -0,0 +1,178 @@
+/*--------------------------------------------------------------------
+This file is part of the Arduino WizFi360 library.
+
+The Arduino WizFi360 library is free software: you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation, either version 3 of the
+License, or (at your option) any later version.
+
+The Arduino WizFi360 library is distributed in the hope that it will be
+useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with The Arduino WizFi360 library.  If not, see
+<http://www.gnu.org/licenses/>.
+--------------------------------------------------------------------*/
+
+#ifndef _TAGMATCHER_H_
+#define _TAGMATCHER_H_
+
+#include <inttypes.h>
+#include <string.h>
+
+
+/*
+ * Multi-pattern matcher (Aho-Corasick automaton) used to find the response
+ * tags in the serial stream.
+ * The automaton is built once from the list of tags, then each received
+ * character is fed with step() which costs O(1) amortized whatever the
+ * number of tags.
+ * The pool of N nodes is part of the object, no memory is allocated.
+ */
+template<unsigned int N>
+class TagMatcher
+{
+	// node indexes are stored in 8 bits
+	static_assert(N>0 and N<=255, "TagMatcher size must be between 1 and 255 nodes");
+
+public:
+	TagMatcher() { build(NULL, 0); }
+
+	/*
+	 * Build the automaton from a list of tags.
+	 * When several tags end at the same position the lowest index is reported.
+	 *
+	 * return: false if the tags do not fit in the node pool
+	 */
+	bool build(const char* const* tags, unsigned int numTags)
+	{
+		// node 0 is the root
+		memset(&_nodes[0], 0, sizeof(Node));
+		_nodes[0].tag = -1;
+		_numNodes = 1;
+		_state = 0;
+
+		// build the trie
+		for (unsigned int i=0; i<numTags; i++)
+		{
+			if (tags[i] == NULL)
+				continue;
+
+			uint8_t s = 0;
+			for (const char* p=tags[i]; *p; p++)
+			{
+				uint8_t t = goTo(s, *p);
+				if (t == 0)
+				{
+					if (_numNodes >= N)
+					{
+						// drop the tags added so far, a truncated tag would match wrongly
+						build(NULL, 0);
+						return false;
+					}
+
+					t = _numNodes++;
+					_nodes[t].c = *p;
+					_nodes[t].child = 0;
+					_nodes[t].next = _nodes[s].child;
+					_nodes[t].fail = 0;
+					_nodes[t].tag = -1;
+					_nodes[s].child = t;
+				}
+				s = t;
+			}
+
+			if (s != 0 and _nodes[s].tag < 0)
+				_nodes[s].tag = i;
+		}
+
+		// compute the failure links in breadth-first order
+		uint8_t queue[N];
+		uint8_t head = 0;
+		uint8_t tail = 0;
+
+		for (uint8_t t=_nodes[0].child; t; t=_nodes[t].next)
+			queue[tail++] = t;
+
+		while (head < tail)
+		{
+			uint8_t s = queue[head++];
+
+			for (uint8_t t=_nodes[s].child; t; t=_nodes[t].next)
+			{
+				uint8_t f = _nodes[s].fail;
+				uint8_t g;
+				while ((g = goTo(f, _nodes[t].c)) == 0 and f != 0)
+					f = _nodes[f].fail;
+				_nodes[t].fail = g;
+
+				// inherit the tag ending in the suffix, lowest index wins
+				int8_t inherited = _nodes[g].tag;
+				if (inherited >= 0 and (_nodes[t].tag < 0 or inherited < _nodes[t].tag))
+					_nodes[t].tag = inherited;
+
+				queue[tail++] = t;
+			}
+		}
+
+		return true;
+	}
+
+	bool build(const char* tag)
+	{
+		return build(&tag, 1);
+	}
+
+	void reset()
+	{
+		_state = 0;
+	}
+
+	/*
+	 * Feed one character.
+	 *
+	 * return: the index of the tag ending with this character, -1 if none
+	 */
+	int step(char c)
+	{
+		uint8_t s = _state;
+		uint8_t t;
+
+		while ((t = goTo(s, c)) == 0 and s != 0)
+			s = _nodes[s].fail;
+
+		_state = t;
+		return _nodes[t].tag;
+	}
+
+
+private:
+
+	struct Node
+	{
+		char c;          // character of the edge leading to this node
+		uint8_t child;   // first child, 0 if none
+		uint8_t next;    // next sibling, 0 if none
+		uint8_t fail;    // longest proper suffix which is also a prefix
+		int8_t tag;      // tag ending in this node (or in its suffixes), -1 if none
+	};
+
+	Node _nodes[N];
+	uint8_t _numNodes;
+	uint8_t _state;
+
+	uint8_t goTo(uint8_t node, char c) const
+	{
+		for (uint8_t t=_nodes[node].child; t; t=_nodes[t].next)
+		{
+			if (_nodes[t].c == c)
+				return t;
+		}
+		return 0;
+	}
+
+};
+
+#endif
@@ -23,69 +23,128 @@ along with The Arduino WizFi360 library.  If not, see
 #include "utility/debug.h"
 
 
+// update the statistics, nothing is compiled if WIZFI360_STATS is 0
+#if WIZFI360_STATS
+#define STATS_ADD(field, n) do { _stats.field += (n); } while (0)
+#else
+#define STATS_ADD(field, n) do { (void)sizeof(n); } while (0)
+#endif
+
+// the buffered data is sent by one AT+CIPSEND
+static_assert(SOCK_TX_BUFFER_SIZE>0 and SOCK_TX_BUFFER_SIZE<=MAX_SEND_SIZE, "SOCK_TX_BUFFER_SIZE must be between 1 and MAX_SEND_SIZE");
+
 #define NUMWIZFI360TAGS 5
 
+// the response tags are followed by the header of the data packets
+#define TAG_IPD NUMWIZFI360TAGS
+#define TAG_RECVDATA (NUMWIZFI360TAGS+1)
+
 const char* WIZFI360TAGS[] =
 {
     "\r\nOK\r\n",
 	"\r\nERROR\r\n",
 	"\r\nFAIL\r\n",
     "\r\nSEND OK\r\n",
-    " CONNECT\r\n"
+    " CONNECT\r\n",
+	"+IPD,",
+	"+CIPRECVDATA:"
 };
 
-typedef enum
+uint8_t WizFi360Drv::_networkNum = 0;
+char WizFi360Drv::_networkSsid[WL_NETWORKS_LIST_MAXNUM][WL_SSID_MAX_LENGTH];
+int32_t WizFi360Drv::_networkRssi[WL_NETWORKS_LIST_MAXNUM];
+uint8_t WizFi360Drv::_networkEncr[WL_NETWORKS_LIST_MAXNUM];
+
+
+WizFi360Drv::WizFi360Drv()
 {
-	TAG_OK,
-	TAG_ERROR,
-	TAG_FAIL,
-	TAG_SENDOK,
-	TAG_CONNECT
-} TagsEnum;
+	wizfi360Serial = NULL;
+
+	_matchRespTags = true;
+	_matchUserTag = false;
+
+	_cmdHead = 0;
+	_cmdCount = 0;
+	_cmdStep = CMD_IDLE;
+	_cmdResult = -1;
+	_cmdStart = 0;
+	_cmdTimeout = 0;
+	_cmdField = 0;
+
+	// cached values of retrieved data
+	_netInfo = NetworkInfo();
+	_netInfoValid = false;
+	_netInfoTime = 0;
+	_netInfoTTL = NETWORK_INFO_TTL;
+	memset(_localIp, 0, sizeof(_localIp));
+	fwVersion[0] = 0;
+
+	_ipdLink = 0;
+	_ipdLen = 0;
+	_ipdField = IPD_NO_HEADER;
+	_ipdValue = 0;
+	_ipdDataLen = 0;
+	_ipdRecvData = false;
+	_recvLink = NO_SOCKET_AVAIL;
+
+	_recvCallback = NULL;
+	_eventCallback = NULL;
+	_wifiStatus = WL_NO_SHIELD;
 
+	for (uint8_t i=0; i<MAX_SOCK_NUM; i++)
+	{
+		_sockState[i] = NA_STATE;
+		_linkState[i] = LINK_UNKNOWN;
+		_linkCheck[i] = 0;
+		_rxLost[i] = false;
+		_rxPending[i] = false;
+		_linkClient[i] = false;
+		_sendSeq[i] = 0;
+		_sendAck[i] = 0;
+		_sendFailed[i] = false;
+		_txLen[i] = 0;
+		_txTime[i] = 0;
+	}
 
-Stream *WizFi360Drv::wizfi360Serial;
+	_sendWindow = 0;
+	_cmdSeq = 0;
+	_cmdAck = 0;
 
-RingBuffer WizFi360Drv::ringBuf(32);
+	_txFlushing = false;
+	_txSends = 0;
+	_txSaved = 0;
 
-// Array of data to cache the information related to the networks discovered
-char 	WizFi360Drv::_networkSsid[][WL_SSID_MAX_LENGTH] = {{"1"},{"2"},{"3"},{"4"},{"5"}};
-int32_t WizFi360Drv::_networkRssi[WL_NETWORKS_LIST_MAXNUM] = { 0 };
-uint8_t WizFi360Drv::_networkEncr[WL_NETWORKS_LIST_MAXNUM] = { 0 };
+	_transparent = false;
+	_transparentTx = 0;
 
-// Cached values of retrieved data
-char WizFi360Drv::_ssid[] = {0};
-uint8_t WizFi360Drv::_bssid[] = {0};
-uint8_t WizFi360Drv::_mac[] = {0};
-uint8_t WizFi360Drv::_localIp[] = {0};
-char WizFi360Drv::fwVersion[] = {0};
+	_lineLen = 0;
+	_bootTime = 0;
 
-long WizFi360Drv::_bufPos=0;
-uint8_t WizFi360Drv::_connId=0;
+#if WIZFI360_STATS
+	memset(&_stats, 0, sizeof(_stats));
+	_cmdSent = 0;
+#endif
 
-uint16_t WizFi360Drv::_remotePort  =0;
-uint8_t WizFi360Drv::_remoteIp[] = {0};
+	_remotePort = 0;
+	memset(_remoteIp, 0, sizeof(_remoteIp));
+}
 
 
 void WizFi360Drv::wifiDriverInit(Stream *wizfi360Serial)
 {
 	LOGDEBUG(F("> wifiDriverInit"));
 
-	WizFi360Drv::wizfi360Serial = wizfi360Serial;
+	this->wizfi360Serial = wizfi360Serial;
 
-	bool initOK = false;
-	
-	for(int i=0; i<5; i++)
+	if (!respTags.build(WIZFI360TAGS, NUMWIZFI360TAGS+2))
 	{
-		if (sendCmd(F("AT")) == TAG_OK)
-		{
-			initOK=true;
-			break;
-		}
-		delay(1000);
+		LOGERROR(F("Response tags do not fit TAG_MATCHER_NODES"));
 	}
 
-	if (!initOK)
+	unsigned long start = millis();
+
+	// the module may still be booting after the power up
+	if (!waitReady(false))
 	{
 		LOGERROR(F("Cannot initialize WizFi360 module"));
 		delay(5000);
@@ -108,6 +167,9 @@ void WizFi360Drv::wifiDriverInit(Stream *wizfi360Serial)
 	{
 		LOGINFO1(F("Initialization successful -"), fwVersion);
 	}
+
+	_bootTime = millis() - start;
+	LOGINFO1(F("Boot time (ms)"), _bootTime);
 }
 
 
@@ -115,8 +177,19 @@ void WizFi360Drv::reset()
 {
 	LOGDEBUG(F("> reset"));
 
+	if (!commandMode())
+		return;
+
 	sendCmd(F("AT+RST"));
-	delay(3000);
+	_wifiStatus = WL_NO_SHIELD;
+	_netInfoValid = false;
+	memset(_linkState, LINK_UNKNOWN, sizeof(_linkState));
+	memset(_rxLost, 0, sizeof(_rxLost));
+	memset(_rxPending, 0, sizeof(_rxPending));
+	if (!waitReady(true))
+	{
+		LOGERROR(F("No answer after the restart"));
+	}
 	wizfi360EmptyBuf(false);  // empty dirty characters from the buffer
 
 	// disable echo of commands
@@ -124,13 +197,15 @@ void WizFi360Drv::reset()
 
 	// set station mode
 	sendCmd(F("AT+CWMODE=1"));
-	delay(200);
 
 	// set multiple connections mode
 	sendCmd(F("AT+CIPMUX=1"));
 
 	// Show remote IP and port with "+IPD"
 	sendCmd(F("AT+CIPDINFO=1"));
+
+	// keep the TCP data in the module until it is read
+	setRecvMode();
 	
 	// Disable autoconnect
 	// Automatic connection can create problems during initialization phase at next boot
@@ -138,7 +213,122 @@ void WizFi360Drv::reset()
 
 	// enable DHCP
 	sendCmd(F("AT+CWDHCP=1,1"));
-	delay(200);
+}
+
+/*
+* Wait until the module answers AT, polling it at short intervals.
+* After a restart the "ready" banner is waited first, the module does not
+* process the commands before.
+* Returns false if the module is not ready after BOOT_TIMEOUT.
+*/
+bool WizFi360Drv::waitReady(bool banner)
+{
+	unsigned long start = millis();
+
+	if (!commandMode())
+		return false;
+
+	if (banner and readUntil(BOOT_TIMEOUT, "ready", false)<0)
+	{
+		LOGWARN(F("Ready banner not received"));
+	}
+
+	// try at least once if the banner used all the time
+	do
+	{
+		AtCommand cmd;
+		initCmd(&cmd, (const char*)F("AT"), true, 100);
+		if (runCmd(&cmd)==TAG_OK)
+		{
+			LOGDEBUG1(F("Module ready (ms)"), millis() - start);
+			return true;
+		}
+	} while (millis() - start < BOOT_TIMEOUT);
+
+	return false;
+}
+
+unsigned long WizFi360Drv::getBootTime()
+{
+	return _bootTime;
+}
+
+
+bool WizFi360Drv::getStats(WizFi360Stats* stats)
+{
+#if WIZFI360_STATS
+	*stats = _stats;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void WizFi360Drv::resetStats()
+{
+#if WIZFI360_STATS
+	memset(&_stats, 0, sizeof(_stats));
+#endif
+}
+
+bool WizFi360Drv::setBaudRate(unsigned long baud, unsigned long currentBaud, WizFi360BaudCallback setHostBaud, bool flowControl)
+{
+	LOGDEBUG1(F("> setBaudRate"), baud);
+
+	if (setHostBaud==NULL or !commandMode())
+		return false;
+
+	// the queued commands are sent at the current baud rate
+	waitCmdQueue();
+
+	if (switchBaudRate(baud, setHostBaud, flowControl))
+	{
+		LOGINFO1(F("Baud rate changed to"), baud);
+		return true;
+	}
+
+	LOGWARN1(F("No answer at baud rate"), baud);
+
+	// the module may have received the command, try to bring it back
+	if (switchBaudRate(currentBaud, setHostBaud, false, true))
+		return false;
+
+	// the link can be recovered by resetting the module
+	LOGERROR(F("Cannot restore the baud rate"));
+	return false;
+}
+
+/*
+* Send AT+UART_CUR, switch the serial port and check that the module
+* answers at the new baud rate.
+* When rolling back the module may not understand the command, the
+* serial port is switched even without OK.
+*/
+bool WizFi360Drv::switchBaudRate(unsigned long baud, WizFi360BaudCallback setHostBaud, bool flowControl, bool rollback)
+{
+	// AT+UART_CUR=<baudrate>,<databits>,<stopbits>,<parity>,<flow control>
+	// the OK is sent at the old baud rate
+	if (sendCmd(F("AT+UART_CUR="), 1000, baud, F(",8,1,0,"), flowControl ? 3 : 0)!=TAG_OK and !rollback)
+	{
+		LOGWARN1(F("Baud rate not accepted"), baud);
+		return false;
+	}
+
+	// wait for the last characters to leave before switching
+	wizfi360Serial->flush();
+	delay(20);
+	setHostBaud(baud, flowControl);
+	delay(20);
+
+	// discard the characters garbled by the switch
+	wizfi360EmptyBuf(false);
+
+	for (int i=0; i<3; i++)
+	{
+		if (sendCmd(F("AT")) == TAG_OK)
+			return true;
+	}
+	return false;
 }
 
 
@@ -152,11 +342,13 @@ bool WizFi360Drv::wifiConnect(const char* ssid, const char* passphrase)
 	// any special characters (',', '"' and '/')
 
     // connect to access point, use CUR mode to avoid connection at boot
-	int ret = sendCmd(F("AT+CWJAP_CUR=\"%s\",\"%s\""), 20000, ssid, passphrase);
+	int ret = sendCmd(F("AT+CWJAP_CUR=\""), 20000, ssid, F("\",\""), passphrase, F("\""));
 
 	if (ret==TAG_OK)
 	{
 		LOGINFO1(F("Connected to"), ssid);
+		_wifiStatus = WL_CONNECTED;
+		_netInfoValid = false;
 		return true;
 	}
 
@@ -175,7 +367,7 @@ bool WizFi360Drv::wifiStartAP(const char* ssid, const char* pwd, uint8_t channel
 	LOGDEBUG(F("> wifiStartAP"));
 
 	// set AP mode, use CUR mode to avoid automatic start at boot
-    int ret = sendCmd(F("AT+CWMODE_CUR=%d"), 10000, wizfi360Mode);
+    int ret = sendCmd(F("AT+CWMODE_CUR="), 10000, wizfi360Mode);
 	if (ret!=TAG_OK)
 	{
 		LOGWARN1(F("Failed to set AP mode"), ssid);
@@ -187,7 +379,7 @@ bool WizFi360Drv::wifiStartAP(const char* ssid, const char* pwd, uint8_t channel
 	// any special characters (',', '"' and '/')
 
 	// start access point
-	ret = sendCmd(F("AT+CWSAP_CUR=\"%s\",\"%s\",%d,%d"), 10000, ssid, pwd, channel, enc);
+	ret = sendCmd(F("AT+CWSAP_CUR=\""), 10000, ssid, F("\",\""), pwd, F("\","), channel, F(","), enc);
 
 	if (ret!=TAG_OK)
 	{
@@ -209,6 +401,9 @@ int8_t WizFi360Drv::disconnect()
 {
 	LOGDEBUG(F("> disconnect"));
 
+	_wifiStatus = WL_DISCONNECTED;
+	_netInfoValid = false;
+
 	if(sendCmd(F("AT+CWQAP"))==TAG_OK)
 		return WL_DISCONNECTED;
 
@@ -232,8 +427,9 @@ void WizFi360Drv::config(IPAddress ip)
 	char buf[16];
 	sprintf_P(buf, PSTR("%d.%d.%d.%d"), ip[0], ip[1], ip[2], ip[3]);
 
-	int ret = sendCmd(F("AT+CIPSTA_CUR=\"%s\""), 2000, buf);
+	int ret = sendCmd(F("AT+CIPSTA_CUR=\""), 2000, buf, F("\""));
 	delay(500);
+	_netInfoValid = false;
 
 	if (ret==TAG_OK)
 	{
@@ -256,7 +452,7 @@ void WizFi360Drv::configAP(IPAddress ip)
 	char buf[16];
 	sprintf_P(buf, PSTR("%d.%d.%d.%d"), ip[0], ip[1], ip[2], ip[3]);
 
-	int ret = sendCmd(F("AT+CIPAP_CUR=\"%s\""), 2000, buf);
+	int ret = sendCmd(F("AT+CIPAP_CUR=\""), 2000, buf, F("\""));
 	delay(500);
 
 	if (ret==TAG_OK)
@@ -293,36 +489,76 @@ uint8_t WizFi360Drv::getConnectionStatus()
 			1: WizFi360 runs as server
 */
 
+	// the changes are notified by WIFI GOT IP and WIFI DISCONNECT
+	poll();
+	if (_wifiStatus!=WL_NO_SHIELD)
+		return _wifiStatus;
+
 	char buf[10] = {0,};
-	if(!sendCmdGet(F("AT+CIPSTATUS"), F("STATUS:"), F("\r\n"), buf, sizeof(buf)))
+	bool ok = sendCmdGet(F("AT+CIPSTATUS"), F("STATUS:"), F("\r\n"), buf, sizeof(buf));
+
+	// a notification received with the response is more recent than the status
+	if (_wifiStatus!=WL_NO_SHIELD)
+		return _wifiStatus;
+
+	if (!ok)
 		return WL_NO_SHIELD;
 
 	// 4: client disconnected
 	// 5: wifi disconnected
 	int s = atoi(buf);
 	if(s==2 or s==3 or s==4)
-		return WL_CONNECTED;
+		_wifiStatus = WL_CONNECTED;
 	else if(s==5)
-		return WL_DISCONNECTED;
+		_wifiStatus = WL_DISCONNECTED;
+	else
+		return WL_IDLE_STATUS;
 
-	return WL_IDLE_STATUS;
+	return _wifiStatus;
 }
 
 uint8_t WizFi360Drv::getClientState(uint8_t sock)
 {
 	LOGDEBUG1(F("> getClientState"), sock);
 
+	if (sock>=MAX_SOCK_NUM)
+		return false;
+
+	// the state is kept by the CONNECT and CLOSED notifications,
+	// the module is only asked when it is unknown or to check it from time to time
+	poll();
+
+	// the module still has the link open, but the stream has a gap
+	if (_rxLost[sock])
+	{
+		closeLostLink(sock);
+		return false;
+	}
+
+	bool check = _linkState[sock]==LINK_UNKNOWN;
+#if LINK_STATE_CHECK_TIME > 0
+	if (millis() - _linkCheck[sock] >= LINK_STATE_CHECK_TIME)
+		check = true;
+#endif
+
+	if (!check)
+		return _linkState[sock]==LINK_CONNECTED;
+
 	char findBuf[20];
 	sprintf_P(findBuf, PSTR("+CIPSTATUS:%d,"), sock);
 
+	_linkCheck[sock] = millis();
+
 	char buf[10] = {0,};
 	if (sendCmdGet(F("AT+CIPSTATUS"), findBuf, ",", buf, sizeof(buf)))
 	{
 		LOGDEBUG(F("Connected"));
+		_linkState[sock] = LINK_CONNECTED;
 		return true;
 	}
 
 	LOGDEBUG(F("Not connected"));
+	_linkState[sock] = LINK_CLOSED;
 	return false;
 }
 
@@ -330,27 +566,8 @@ uint8_t* WizFi360Drv::getMacAddress()
 {
 	LOGDEBUG(F("> getMacAddress"));
 
-	memset(_mac, 0, WL_MAC_ADDR_LENGTH);
-
-	char buf[20];
-	if (sendCmdGet(F("AT+CIFSR"), F(":STAMAC,\""), F("\""), buf, sizeof(buf)))
-	{
-		char* token;
-
-		token = strtok(buf, ":");
-		_mac[5] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_mac[4] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_mac[3] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_mac[2] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_mac[1] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_mac[0] = (byte)strtol(token, NULL, 16);
-	}
-	return _mac;
+	getNetworkInfo(NULL);
+	return _netInfo.mac;
 }
 
 
@@ -358,23 +575,8 @@ void WizFi360Drv::getIpAddress(IPAddress& ip)
 {
 	LOGDEBUG(F("> getIpAddress"));
 
-	char buf[20];
-	memset(buf, '\0', sizeof(buf));
-	if (sendCmdGet(F("AT+CIFSR"), F(":STAIP,\""), F("\""), buf, sizeof(buf)))
-	{
-		char* token;
-
-		token = strtok(buf, ".");
-		_localIp[0] = atoi(token);
-		token = strtok(NULL, ".");
-		_localIp[1] = atoi(token);
-		token = strtok(NULL, ".");
-		_localIp[2] = atoi(token);
-		token = strtok(NULL, ".");
-		_localIp[3] = atoi(token);
-
-		ip = _localIp;
-	}
+	if (getNetworkInfo(NULL))
+		ip = _netInfo.localIp;
 }
 
 void WizFi360Drv::getIpAddressAP(IPAddress& ip)
@@ -406,132 +608,239 @@ char* WizFi360Drv::getCurrentSSID()
 {
 	LOGDEBUG(F("> getCurrentSSID"));
 
-	_ssid[0] = 0;
-	sendCmdGet(F("AT+CWJAP?"), F("+CWJAP:\""), F("\""), _ssid, sizeof(_ssid));
-
-	return _ssid;
+	getNetworkInfo(NULL);
+	return _netInfo.ssid;
 }
 
 uint8_t* WizFi360Drv::getCurrentBSSID()
 {
 	LOGDEBUG(F("> getCurrentBSSID"));
 
-	memset(_bssid, 0, WL_MAC_ADDR_LENGTH);
-
-	char buf[20];
-	if (sendCmdGet(F("AT+CWJAP?"), F(",\""), F("\","), buf, sizeof(buf)))
-	{
-		char* token;
-
-		token = strtok(buf, ":");
-		_bssid[5] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_bssid[4] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_bssid[3] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_bssid[2] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_bssid[1] = (byte)strtol(token, NULL, 16);
-		token = strtok(NULL, ":");
-		_bssid[0] = (byte)strtol(token, NULL, 16);
-	}
-	return _bssid;
-
+	getNetworkInfo(NULL);
+	return _netInfo.bssid;
 }
 
 int32_t WizFi360Drv::getCurrentRSSI()
 {
 	LOGDEBUG(F("> getCurrentRSSI"));
 
-    int ret=0;
-	char buf[10] = {0,};
-	sendCmdGet(F("AT+CWJAP?"), F(",-"), F("\r\n"), buf, sizeof(buf));
+	getNetworkInfo(NULL);
+	return _netInfo.rssi;
+}
 
-	if (isDigit(buf[0])) {
-      ret = -atoi(buf);
-    }
 
-    return ret;
+uint8_t WizFi360Drv::getScanNetworks()
+{
+	_networkNum = 0;
+
+	if (scanNetworks(storeNetwork, NULL, WL_NETWORKS_LIST_MAXNUM)<0)
+		return -1;
+
+	return _networkNum;
 }
 
+// Fill the scan list, keeping the strongest networks if the module did not sort them
+void WizFi360Drv::storeNetwork(const char* ssid, int32_t rssi, uint8_t encType, void* ctx)
+{
+	uint8_t i = _networkNum;
 
-uint8_t WizFi360Drv::getScanNetworks()
+	if (i<WL_NETWORKS_LIST_MAXNUM)
+	{
+		_networkNum++;
+	}
+	else
+	{
+		// replace the weakest one
+		i = 0;
+		for (uint8_t j=1; j<WL_NETWORKS_LIST_MAXNUM; j++)
+		{
+			if (_networkRssi[j] < _networkRssi[i])
+				i = j;
+		}
+		if (rssi <= _networkRssi[i])
+			return;
+	}
+
+	memset(_networkSsid[i], 0, WL_SSID_MAX_LENGTH);
+	strncpy(_networkSsid[i], ssid, WL_SSID_MAX_LENGTH-1);
+	_networkRssi[i] = rssi;
+	_networkEncr[i] = encType;
+}
+
+int WizFi360Drv::scanNetworks(WizFi360ScanCallback callback, void* ctx, uint8_t maxResults)
 {
-    uint8_t ssidListNum = 0;
-    int idx;	
+	int num = 0;
+	int idx;
+
+	if (!commandMode())
+		return -1;
 
+	// sort by RSSI and list only <ecn>,<ssid>,<rssi>
+	if (sendCmd(F("AT+CWLAPOPT=1,7"))!=TAG_OK)
+	{
+		LOGWARN(F("AT+CWLAPOPT not supported"));
+		maxResults = 0;
+	}
+
+	waitCmdQueue();
 	wizfi360EmptyBuf();
 
 	LOGDEBUG(F("----------------------------------------------"));
 	LOGDEBUG(F(">> AT+CWLAP"));
-	
+
 	wizfi360Serial->println(F("AT+CWLAP"));
-	
+
+	// +CWLAP:(<ecn>,"<ssid>",<rssi>)
 	idx = readUntil(10000, "+CWLAP:(");
-	
+
 	while (idx == NUMWIZFI360TAGS)
 	{
-		_networkEncr[ssidListNum] = wizfi360Serial->parseInt();
-		
+		char ssid[WL_SSID_MAX_LENGTH] = {0};
+
+		uint8_t encType = wizfi360Serial->parseInt();
+
 		// discard , and " characters
 		readUntil(1000, "\"");
 
 		idx = readUntil(1000, "\"", false);
 		if(idx==NUMWIZFI360TAGS)
 		{
-			memset(_networkSsid[ssidListNum], 0, WL_SSID_MAX_LENGTH );
-			ringBuf.getStrN(_networkSsid[ssidListNum], 1, WL_SSID_MAX_LENGTH-1);
+			ringBuf.getStrN(ssid, 1, WL_SSID_MAX_LENGTH-1);
 		}
-		
+
 		// discard , character
 		readUntil(1000, ",");
-		
-		_networkRssi[ssidListNum] = wizfi360Serial->parseInt();
-		
-		idx = readUntil(1000, "+CWLAP:(");
 
-		if(ssidListNum==WL_NETWORKS_LIST_MAXNUM-1)
-			break;
+		int32_t rssi = wizfi360Serial->parseInt();
+
+		// the following access points are read to the end of the response
+		if (maxResults==0 or num<maxResults)
+		{
+			callback(ssid, rssi, encType, ctx);
+			num++;
+		}
 
-		ssidListNum++;
+		idx = readUntil(1000, "+CWLAP:(");
 	}
-	
+
 	if (idx==-1)
 		return -1;
 
-	LOGDEBUG1(F("---------------------------------------------- >"), ssidListNum);
+	LOGDEBUG1(F("---------------------------------------------- >"), num);
 	LOGDEBUG();
-    return ssidListNum;
+	return num;
 }
 
 bool WizFi360Drv::getNetmask(IPAddress& mask) {
 	LOGDEBUG(F("> getNetmask"));
 
-	char buf[20];
-	if (sendCmdGet(F("AT+CIPSTA?"), F("+CIPSTA:netmask:\""), F("\""), buf, sizeof(buf)))
-	{
-		mask.fromString (buf);
-		return true;
-	}
+	if (!getNetworkInfo(NULL))
+		return false;
 
-	return false;
+	mask = _netInfo.netmask;
+	return true;
 }
 
 bool WizFi360Drv::getGateway(IPAddress& gw)
 {
 	LOGDEBUG(F("> getGateway"));
 
-	char buf[20];
-	if (sendCmdGet(F("AT+CIPSTA?"), F("+CIPSTA:gateway:\""), F("\""), buf, sizeof(buf)))
+	if (!getNetworkInfo(NULL))
+		return false;
+
+	gw = _netInfo.gateway;
+	return true;
+}
+
+bool WizFi360Drv::getNetworkInfo(NetworkInfo* info, bool refresh)
+{
+	if (refresh or !_netInfoValid or millis() - _netInfoTime >= _netInfoTTL)
+		updateNetworkInfo();
+
+	if (info!=NULL)
+		*info = _netInfo;
+
+	return _netInfoValid;
+}
+
+void WizFi360Drv::setNetworkInfoTTL(unsigned long ttl)
+{
+	_netInfoTTL = ttl;
+}
+
+// Read all the settings of the station, each reply is parsed at once
+void WizFi360Drv::updateNetworkInfo()
+{
+	LOGDEBUG(F("> updateNetworkInfo"));
+
+	char ip[16] = {0};
+	char mac[18] = {0};
+	char bssid[18] = {0};
+	char rssi[6] = {0};
+	char gw[16] = {0};
+	char mask[16] = {0};
+
+	memset(_netInfo.ssid, 0, sizeof(_netInfo.ssid));
+
+	// +CIFSR:STAIP,"<IP address>"
+	// +CIFSR:STAMAC,"<MAC address>"
+	CmdField cifsr[] =
 	{
-		gw.fromString (buf);
-		return true;
-	}
+		{ PSTR(":STAIP,\""), PSTR("\""), ip, sizeof(ip) },
+		{ PSTR(":STAMAC,\""), PSTR("\""), mac, sizeof(mac) }
+	};
+	_netInfoValid = sendCmdGetFields(F("AT+CIFSR"), cifsr, 2)==2;
 
-	return false;
+	// +CWJAP:<ssid>,<bssid>,<channel>,<rssi>
+	CmdField cwjap[] =
+	{
+		{ PSTR("+CWJAP:\""), PSTR("\""), _netInfo.ssid, sizeof(_netInfo.ssid) },
+		{ PSTR(",\""), PSTR("\""), bssid, sizeof(bssid) },
+		{ PSTR(",-"), PSTR("\r\n"), rssi, sizeof(rssi) }
+	};
+	sendCmdGetFields(F("AT+CWJAP?"), cwjap, 3);
+
+	// +CIPSTA:ip:<IP address>
+	// +CIPSTA:gateway:<gateway>
+	// +CIPSTA:netmask:<netmask>
+	CmdField cipsta[] =
+	{
+		{ PSTR("+CIPSTA:gateway:\""), PSTR("\""), gw, sizeof(gw) },
+		{ PSTR("+CIPSTA:netmask:\""), PSTR("\""), mask, sizeof(mask) }
+	};
+	sendCmdGetFields(F("AT+CIPSTA?"), cipsta, 2);
+
+	_netInfo.localIp = IPAddress();
+	_netInfo.gateway = IPAddress();
+	_netInfo.netmask = IPAddress();
+	_netInfo.localIp.fromString(ip);
+	_netInfo.gateway.fromString(gw);
+	_netInfo.netmask.fromString(mask);
+
+	parseMacAddress(mac, _netInfo.mac);
+	parseMacAddress(bssid, _netInfo.bssid);
+
+	_netInfo.rssi = 0;
+	if (isDigit(rssi[0]))
+		_netInfo.rssi = -atoi(rssi);
+
+	_netInfoTime = millis();
+}
+
+// The bytes are stored in reverse order
+void WizFi360Drv::parseMacAddress(char* str, uint8_t* mac)
+{
+	memset(mac, 0, WL_MAC_ADDR_LENGTH);
+
+	char* token = strtok(str, ":");
+	for (int i=WL_MAC_ADDR_LENGTH-1; i>=0 and token!=NULL; i--)
+	{
+		mac[i] = (byte)strtol(token, NULL, 16);
+		token = strtok(NULL, ":");
+	}
 }
 
+
 char* WizFi360Drv::getSSIDNetoworks(uint8_t networkItem)
 {
 	if (networkItem >= WL_NETWORKS_LIST_MAXNUM)
@@ -573,7 +882,7 @@ bool WizFi360Drv::ping(const char *host)
 {
 	LOGDEBUG(F("> ping"));
 
-	int ret = sendCmd(F("AT+PING=\"%s\""), 8000, host);
+	int ret = sendCmd(F("AT+PING=\""), 8000, host, F("\""));
 	
 	if (ret==TAG_OK)
 		return true;
@@ -588,7 +897,13 @@ bool WizFi360Drv::startServer(uint16_t port, uint8_t sock)
 {
 	LOGDEBUG1(F("> startServer"), port);
 
-	int ret = sendCmd(F("AT+CIPSERVER=%d,%d"), 1000, sock, port);
+	// the connections accepted on links above MAX_SOCK_NUM would be lost
+	if (sendCmd(F("AT+CIPSERVERMAXCONN="), 1000, MAX_SOCK_NUM)!=TAG_OK)
+	{
+		LOGWARN(F("Cannot limit the server connections"));
+	}
+
+	int ret = sendCmd(F("AT+CIPSERVER="), 1000, sock, F(","), port);
 
 	return ret==TAG_OK;
 }
@@ -610,17 +925,30 @@ bool WizFi360Drv::startClient(const char* host, uint16_t port, uint8_t sock, uin
 	
 	int ret = -1;
 	if (protMode==TCP_MODE)
-		ret = sendCmd(F("AT+CIPSTART=%d,\"TCP\",\"%s\",%u"), 5000, sock, host, port);
+		ret = sendCmd(F("AT+CIPSTART="), 5000, sock, F(",\"TCP\",\""), host, F("\","), port);
 	else if (protMode==SSL_MODE)
 	{
 		// better to put the CIPSSLSIZE here because it is not supported before firmware 1.4
 		sendCmd(F("AT+CIPSSLSIZE=4096"));
-		ret = sendCmd(F("AT+CIPSTART=%d,\"SSL\",\"%s\",%u"), 5000, sock, host, port);
+		ret = sendCmd(F("AT+CIPSTART="), 5000, sock, F(",\"SSL\",\""), host, F("\","), port);
 	}
 	else if (protMode==UDP_MODE)
-		ret = sendCmd(F("AT+CIPSTART=%d,\"UDP\",\"%s\",0,%u,2"), 5000, sock, host, port);
+		ret = sendCmd(F("AT+CIPSTART="), 5000, sock, F(",\"UDP\",\""), host, F("\",0,"), port, F(",2"));
 
-	return ret==TAG_OK;
+	if (ret!=TAG_OK)
+		return false;
+
+	_rxBuf[sock].clear();
+	_txLen[sock] = 0;
+	_linkState[sock] = LINK_CONNECTED;
+	_linkCheck[sock] = millis();
+	_rxLost[sock] = false;
+	_rxPending[sock] = false;
+	_linkClient[sock] = true;
+	_sendSeq[sock] = 0;
+	_sendAck[sock] = 0;
+	_sendFailed[sock] = false;
+	return true;
 }
 
 
@@ -629,7 +957,30 @@ void WizFi360Drv::stopClient(uint8_t sock)
 {
 	LOGDEBUG1(F("> stopClient"), sock);
 
-	sendCmd(F("AT+CIPCLOSE=%d"), 4000, sock);
+	// let the buffered data and segments go out before closing
+	if (!flushData(sock))
+	{
+		LOGWARN1(F("Closing with data not sent on link"), sock);
+	}
+	if (sock<MAX_SOCK_NUM and !waitSendWindow(sock, 0))
+	{
+		LOGWARN1(F("Closing with segments not sent on link"), sock);
+	}
+
+	sendCmd(F("AT+CIPCLOSE="), 4000, sock);
+
+	if (sock<MAX_SOCK_NUM)
+	{
+		_rxBuf[sock].clear();
+		_txLen[sock] = 0;
+		_linkState[sock] = LINK_CLOSED;
+		_rxLost[sock] = false;
+		_rxPending[sock] = false;
+		_linkClient[sock] = false;
+		_sendSeq[sock] = 0;
+		_sendAck[sock] = 0;
+		_sendFailed[sock] = false;
+	}
 }
 
 
@@ -648,479 +999,1699 @@ uint8_t WizFi360Drv::getServerState(uint8_t sock)
 
 uint16_t WizFi360Drv::availData(uint8_t connId)
 {
-    //LOGDEBUG(bufPos);
+	if (connId>=MAX_SOCK_NUM)
+		return 0;
 
-	// if there is data in the buffer
-	if (_bufPos>0)
+	// the reply will not come before the request is sent
+	if (!flushData(connId))
 	{
-		if (_connId==connId)
-			return _bufPos;
-		else if (_connId==0)
-			return _bufPos;
+		LOGERROR1(F("Failed to send the buffered data on link"), connId);
 	}
 
+	// dispatch the received data packets
+	poll();
 
-    int bytes = wizfi360Serial->available();
+	// then ask the module for the data it keeps, once there is room for it
+	RxBuffer* rx = &_rxBuf[connId];
+	if (_rxPending[connId] and (rx->available()==0 or rx->room()>=RECV_CHUNK_SIZE))
+		recvData(connId);
 
-	if (bytes)
-	{
-		//LOGDEBUG1(F("Bytes in the serial buffer: "), bytes);
-		if (wizfi360Serial->find((char *)"+IPD,"))
-		{
-			// format is : +IPD,<id>,<len>:<data>
-			// format is : +IPD,<ID>,<len>[,<remote IP>,<remote port>]:<data>
-
-			_connId = wizfi360Serial->parseInt();    // <ID>
-			wizfi360Serial->read();                  // ,
-			_bufPos = wizfi360Serial->parseInt();    // <len>
-			wizfi360Serial->read();                  // "
-			_remoteIp[0] = wizfi360Serial->parseInt();    // <remote IP>
-			wizfi360Serial->read();                  // .
-			_remoteIp[1] = wizfi360Serial->parseInt();
-			wizfi360Serial->read();                  // .
-			_remoteIp[2] = wizfi360Serial->parseInt();
-			wizfi360Serial->read();                  // .
-			_remoteIp[3] = wizfi360Serial->parseInt();
-			wizfi360Serial->read();                  // "
-			wizfi360Serial->read();                  // ,
-			_remotePort = wizfi360Serial->parseInt();     // <remote port>
-			
-			wizfi360Serial->read();                  // :
-
-			LOGDEBUG();
-			LOGDEBUG2(F("Data packet"), _connId, _bufPos);
-
-			if(_connId==connId || connId==0)
-				return _bufPos;
-		}
-	}
-	return 0;
+	return rx->available();
 }
 
+/*
+* Move the data kept by the module in passive receive mode to the receive
+* buffer of the link, as much as the buffer can hold.
+* The payload of the response is parsed like the one of a data packet.
+*/
+void WizFi360Drv::recvData(uint8_t sock)
+{
+	uint16_t room = _rxBuf[sock].room();
+
+	// set again by the next notification of the module
+	_rxPending[sock] = false;
 
-bool WizFi360Drv::getData(uint8_t connId, uint8_t *data, bool peek, bool* connClose)
+	_recvLink = sock;
+	_ipdDataLen = 0;
+	int ret = sendCmd(F("AT+CIPRECVDATA="), 1000, sock, F(","), room);
+	_recvLink = NO_SOCKET_AVAIL;
+
+	// the module may have more than asked
+	if (ret==TAG_OK and _ipdDataLen>=room)
+		_rxPending[sock] = true;
+}
+
+void WizFi360Drv::setRecvCallback(WizFi360RecvCallback callback)
 {
-	if (connId!=_connId)
-		return false;
+	_recvCallback = callback;
 
+	if (wizfi360Serial!=NULL)
+		setRecvMode();
+}
 
-	// see Serial.timedRead
+// Keep the TCP data in the module until recvData asks for it (passive mode),
+// the receive buffers could not hold a packet arriving during an AT command.
+// The receive callback takes the data as it arrives (active mode).
+void WizFi360Drv::setRecvMode()
+{
+	bool passive = _recvCallback==NULL;
 
-	long _startMillis = millis();
+	if (sendCmd(F("AT+CIPRECVMODE="), 1000, passive ? 1 : 0)!=TAG_OK and passive)
+	{
+		LOGWARN(F("AT+CIPRECVMODE not supported, data may be dropped"));
+	}
+}
+
+void WizFi360Drv::setEventCallback(WizFi360EventCallback callback)
+{
+	_eventCallback = callback;
+}
+
+
+uint8_t WizFi360Drv::getServerLink()
+{
+	poll();
+
+	for (uint8_t i=0; i<MAX_SOCK_NUM; i++)
+	{
+		if (!_linkClient[i] and (_rxBuf[i].available() or _rxPending[i]))
+			return i;
+	}
+	return NO_SOCKET_AVAIL;
+}
+
+
+bool WizFi360Drv::getData(uint8_t connId, uint8_t *data, bool peek, bool* connClose)
+{
+	if (connId>=MAX_SOCK_NUM)
+		return false;
+
+	RxBuffer* rx = &_rxBuf[connId];
+
+	// see Serial.timedRead
+
+	long _startMillis = millis();
 	do
 	{
-		if (wizfi360Serial->available())
+		if (rx->available())
 		{
 			if (peek)
 			{
-				*data = (char)wizfi360Serial->peek();
+				*data = (char)rx->peek();
 			}
 			else
 			{
-				*data = (char)wizfi360Serial->read();
-				_bufPos--;
+				*data = (char)rx->read();
 			}
 			//Serial.print((char)*data);
 
-			if (_bufPos == 0)
+			// the serial stream belongs to the AT command in progress
+			bool lastByte = !peek and rx->available()==0 and !_rxPending[connId] and
+				!(_ipdLen>0 and _ipdLink==connId) and _cmdCount==0;
+
+			if (lastByte)
 			{
-				// after the data packet a ",CLOSED" string may be received
+				// after the data packet a "<link ID>,CLOSED" notification may be received
 				// this means that the socket is now closed
+				// a notification not received yet is processed by the next call
 
-				delay(5);
+				poll();
 
-				if (wizfi360Serial->available())
+				if (_linkState[connId]==LINK_CLOSED and !_rxPending[connId])
 				{
-					//LOGDEBUG(".2");
-					//LOGDEBUG(wizfi360Serial->peek());
-
-					// 48 = '0'
-					if (wizfi360Serial->peek()==48+connId)
-					{
-						int idx = readUntil(500, ",CLOSED\r\n", false);
-						if(idx!=NUMWIZFI360TAGS)
-						{
-							LOGERROR(F("Tag CLOSED not found"));
-						}
-
-						LOGDEBUG();
-						LOGDEBUG(F("Connection closed"));
-
-						*connClose=true;
-					}
+					LOGDEBUG();
+					LOGDEBUG(F("Connection closed"));
+
+					if (_rxLost[connId])
+						closeLostLink(connId);
+
+					*connClose=true;
 				}
 			}
 
 			return true;
 		}
+
+		availData(connId);
 	} while(millis() - _startMillis < 2000);
 
-    // timed out, reset the buffer
-	LOGERROR1(F("TIMEOUT:"), _bufPos);
+    // timed out
+	LOGERROR1(F("TIMEOUT:"), connId);
 
-    _bufPos = 0;
-	_connId = 0;
 	*data = 0;
-	
+
 	return false;
 }
 
 /**
  * Receive the data into a buffer.
- * It reads up to bufSize bytes.
+ * It reads up to bufSize bytes, without waiting for the bytes not yet received.
  * @return	received data size for success else -1.
  */
 int WizFi360Drv::getDataBuf(uint8_t connId, uint8_t *buf, uint16_t bufSize)
 {
-	if (connId!=_connId)
-		return false;
+	if (connId>=MAX_SOCK_NUM)
+		return -1;
 
-	if(_bufPos<bufSize)
-		bufSize = _bufPos;
-	
-	for(uint16_t i=0; i<bufSize; i++)
+	// first the data already moved to the receive buffer
+	uint16_t n = _rxBuf[connId].read(buf, bufSize);
+
+	// then the rest of the data packet in progress, straight from the serial buffer
+	if (n<bufSize and _ipdLen>0 and _ipdLink==connId)
 	{
-		int c = timedRead();
-		//LOGDEBUG(c);
-		if(c==-1)
-			return -1;
-		
-		buf[i] = (char)c;
-		_bufPos--;
+		uint16_t len = bufSize-n;
+		if (len>_ipdLen)
+			len = _ipdLen;
+
+		int avail = wizfi360Serial->available();
+		if (len>avail)
+			len = avail;
+
+		if (len>0)
+		{
+			len = readAvailable(buf+n, len);
+			_ipdLen -= len;
+			n += len;
+			STATS_ADD(uartRx, len);
+			STATS_ADD(linkRx[connId], len);
+		}
 	}
 
-	return bufSize;
+	return n;
 }
 
 
-bool WizFi360Drv::sendData(uint8_t sock, const uint8_t *data, uint16_t len)
+bool WizFi360Drv::sendData(uint8_t sock, const uint8_t *data, size_t len)
 {
 	LOGDEBUG2(F("> sendData:"), sock, len);
 
-	char cmdBuf[20];
-	sprintf_P(cmdBuf, PSTR("AT+CIPSEND=%d,%u"), sock, len);
-	wizfi360Serial->println(cmdBuf);
-
-	int idx = readUntil(1000, (char *)">", false);
-	if(idx!=NUMWIZFI360TAGS)
+	// one AT+CIPSEND for each slice of MAX_SEND_SIZE bytes
+	do
 	{
-		LOGERROR(F("Data packet send error (1)"));
-		return false;
-	}
+		uint16_t n = len>MAX_SEND_SIZE ? MAX_SEND_SIZE : len;
 
-	wizfi360Serial->write(data, len);
+		AtCommand cmd;
+		initCmd(&cmd, NULL, false, 1000);
+		cmd.data = data;
+		cmd.dataLen = n;
 
-	idx = readUntil(2000);
-	if(idx!=TAG_SENDOK)
-	{
-		LOGERROR(F("Data packet send error (2)"));
-		return false;
-	}
+		if (!sendLinkData(sock, &cmd, n))
+			return false;
 
-    return true;
+		data += n;
+		len -= n;
+	} while (len>0);
+
+	return true;
 }
 
 // Override sendData method for __FlashStringHelper strings
-bool WizFi360Drv::sendData(uint8_t sock, const __FlashStringHelper *data, uint16_t len, bool appendCrLf)
+bool WizFi360Drv::sendData(uint8_t sock, const __FlashStringHelper *data, size_t len, bool appendCrLf)
 {
 	LOGDEBUG2(F("> sendData:"), sock, len);
 
-	char cmdBuf[20];
-	uint16_t len2 = len + 2*appendCrLf;
-	sprintf_P(cmdBuf, PSTR("AT+CIPSEND=%d,%u"), sock, len2);
-	wizfi360Serial->println(cmdBuf);
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(data);
 
-	int idx = readUntil(1000, (char *)">", false);
-	if(idx!=NUMWIZFI360TAGS)
+	// one AT+CIPSEND for each slice of MAX_SEND_SIZE bytes, CR LF is sent with the last one
+	do
 	{
-		LOGERROR(F("Data packet send error (1)"));
-		return false;
-	}
+		uint16_t n = len>MAX_SEND_SIZE ? MAX_SEND_SIZE : len;
+		bool crLf = appendCrLf and len-n==0 and n+2<=MAX_SEND_SIZE;
 
-	//wizfi360Serial->write(data, len);
-	PGM_P p = reinterpret_cast<PGM_P>(data);
-	for (uint16_t i=0; i<len; i++)
+		AtCommand cmd;
+		initCmd(&cmd, NULL, false, 1000);
+		cmd.data = p;
+		cmd.dataLen = n;
+		cmd.dataP = true;
+		cmd.appendCrLf = crLf;
+
+		if (!sendLinkData(sock, &cmd, n + 2*crLf))
+			return false;
+
+		if (crLf)
+			appendCrLf = false;
+		p += n;
+		len -= n;
+	} while (len>0 or appendCrLf);
+
+	return true;
+}
+
+bool WizFi360Drv::sendData(uint8_t sock, const DataFragment* frags, uint8_t count)
+{
+	size_t total = fragmentsLength(frags, count);
+
+	LOGDEBUG2(F("> sendData:"), sock, total);
+
+	// one AT+CIPSEND for each slice of MAX_SEND_SIZE bytes, across the fragments
+	size_t offset = 0;
+	do
 	{
-		unsigned char c = pgm_read_byte(p++);
-		wizfi360Serial->write(c);
-	}
-	if (appendCrLf)
+		uint16_t n = total-offset>MAX_SEND_SIZE ? MAX_SEND_SIZE : total-offset;
+
+		AtCommand cmd;
+		initCmd(&cmd, NULL, false, 1000);
+		cmd.frags = frags;
+		cmd.numFrags = count;
+		cmd.fragsOffset = offset;
+		cmd.dataLen = n;
+
+		if (!sendLinkData(sock, &cmd, n))
+			return false;
+
+		offset += n;
+	} while (offset<total);
+
+	return true;
+}
+
+bool WizFi360Drv::sendDataUdp(uint8_t sock, const char* host, uint16_t port, const uint8_t *data, size_t len)
+{
+	DataFragment frag = { data, len, false };
+	return sendDataUdp(sock, host, port, &frag, 1);
+}
+
+bool WizFi360Drv::sendDataUdp(uint8_t sock, const char* host, uint16_t port, const DataFragment* frags, uint8_t count)
+{
+	// a datagram is not split
+	size_t total = fragmentsLength(frags, count);
+	if (total>MAX_SEND_SIZE)
 	{
-		wizfi360Serial->write('\r');
-		wizfi360Serial->write('\n');
+		LOGERROR1(F("Datagram too large"), total);
+		return false;
 	}
+	uint16_t len = total;
+
+	LOGDEBUG2(F("> sendDataUdp:"), sock, len);
+	LOGDEBUG2(F("> sendDataUdp:"), host, port);
+
+	// AT+CIPSEND=<link ID>,<length>,<remote IP>,<remote port>
+	CmdArgs<uint8_t, const __FlashStringHelper*, uint16_t, const __FlashStringHelper*, const char*, const __FlashStringHelper*, uint16_t>
+		args(sock, F(","), len, F(",\""), host, F("\","), port);
 
-	idx = readUntil(2000);
-	if(idx!=TAG_SENDOK)
+	AtCommand cmd;
+	initCmd(&cmd, (const char*)F("AT+CIPSEND="), true, 1000);
+	setCmdArgs(&cmd, &args);
+	cmd.frags = frags;
+	cmd.numFrags = count;
+	cmd.dataLen = len;
+
+	if (runCmd(&cmd)!=TAG_SENDOK)
 	{
-		LOGERROR(F("Data packet send error (2)"));
+		STATS_ADD(sendFailures, 1);
 		return false;
 	}
 
-    return true;
+	if (sock<MAX_SOCK_NUM)
+		STATS_ADD(linkTx[sock], len);
+	return true;
 }
 
-bool WizFi360Drv::sendDataUdp(uint8_t sock, const char* host, uint16_t port, const uint8_t *data, uint16_t len)
+
+bool WizFi360Drv::writeData(uint8_t sock, const uint8_t *data, size_t len)
 {
-	LOGDEBUG2(F("> sendDataUdp:"), sock, len);
-	LOGDEBUG2(F("> sendDataUdp:"), host, port);
+	if (sock>=MAX_SOCK_NUM)
+		return sendData(sock, data, len);
 
-	char cmdBuf[40];
-	sprintf_P(cmdBuf, PSTR("AT+CIPSEND=%d,%u,\"%s\",%u"), sock, len, host, port);
-	//LOGDEBUG1(F("> sendDataUdp:"), cmdBuf);
-	wizfi360Serial->println(cmdBuf);
+	if (_txLen[sock]>0)
+		_txSaved++;
 
-	int idx = readUntil(1000, (char *)">", false);
-	if(idx!=NUMWIZFI360TAGS)
+	while (len>0)
 	{
-		LOGERROR(F("Data packet send error (1)"));
-		return false;
+		// a large block is sent directly when nothing is buffered
+		if (_txLen[sock]==0 and len>=SOCK_TX_BUFFER_SIZE)
+			return sendData(sock, data, len);
+
+		uint16_t n = SOCK_TX_BUFFER_SIZE - _txLen[sock];
+		if (n>len)
+			n = len;
+
+		memcpy(_txBuf[sock] + _txLen[sock], data, n);
+		_txLen[sock] += n;
+		data += n;
+		len -= n;
+
+		if (_txLen[sock]==SOCK_TX_BUFFER_SIZE and !flushData(sock))
+			return false;
 	}
 
-	wizfi360Serial->write(data, len);
+	_txTime[sock] = millis();
+	return true;
+}
+
+// Override writeData method for __FlashStringHelper strings
+bool WizFi360Drv::writeData(uint8_t sock, const __FlashStringHelper *data, size_t len, bool appendCrLf)
+{
+	size_t size = len + 2*appendCrLf;
 
-	idx = readUntil(2000);
-	if(idx!=TAG_SENDOK)
+	if (sock>=MAX_SOCK_NUM or size>=SOCK_TX_BUFFER_SIZE)
 	{
-		LOGERROR(F("Data packet send error (2)"));
+		// send the buffered data first to keep the order
+		if (!flushData(sock))
+			return false;
+
+		return sendData(sock, data, len, appendCrLf);
+	}
+
+	if (_txLen[sock] + size > (size_t)SOCK_TX_BUFFER_SIZE and !flushData(sock))
 		return false;
+
+	if (_txLen[sock]>0)
+		_txSaved++;
+
+	uint8_t* p = _txBuf[sock] + _txLen[sock];
+	memcpy_P(p, reinterpret_cast<PGM_P>(data), len);
+	if (appendCrLf)
+	{
+		p[len] = '\r';
+		p[len+1] = '\n';
 	}
+	_txLen[sock] += size;
 
-    return true;
+	_txTime[sock] = millis();
+	return true;
 }
 
+// Override writeData method for data in fragments
+bool WizFi360Drv::writeData(uint8_t sock, const DataFragment* frags, uint8_t count)
+{
+	size_t total = fragmentsLength(frags, count);
 
+	if (sock>=MAX_SOCK_NUM or _txLen[sock] + total > (size_t)SOCK_TX_BUFFER_SIZE)
+	{
+		// send the buffered data first to keep the order
+		if (!flushData(sock))
+			return false;
 
-void WizFi360Drv::getRemoteIpAddress(IPAddress& ip)
+		return sendData(sock, frags, count);
+	}
+
+	if (_txLen[sock]>0)
+		_txSaved++;
+
+	for (uint8_t i=0; i<count; i++)
+	{
+		uint8_t* p = _txBuf[sock] + _txLen[sock];
+		if (frags[i].flash)
+			memcpy_P(p, reinterpret_cast<PGM_P>(frags[i].data), frags[i].len);
+		else
+			memcpy(p, frags[i].data, frags[i].len);
+		_txLen[sock] += frags[i].len;
+	}
+
+	_txTime[sock] = millis();
+	return true;
+}
+
+bool WizFi360Drv::flushData(uint8_t sock)
 {
-	ip = _remoteIp;
+	if (sock>=MAX_SOCK_NUM or _txLen[sock]==0)
+		return true;
+
+	LOGDEBUG2(F("> flushData:"), sock, _txLen[sock]);
+
+	// poll() must not send the buffer again while it is sent
+	_txFlushing = true;
+	bool ret = sendData(sock, _txBuf[sock], _txLen[sock]);
+	_txLen[sock] = 0;
+	_txFlushing = false;
+
+	return ret;
 }
 
-uint16_t WizFi360Drv::getRemotePort()
+void WizFi360Drv::getTxCounters(unsigned long* sends, unsigned long* saved)
 {
-	return _remotePort;
+	*sends = _txSends;
+	*saved = _txSaved;
 }
 
 
-////////////////////////////////////////////////////////////////////////////
-// Utility functions
-////////////////////////////////////////////////////////////////////////////
+bool WizFi360Drv::setSendWindow(uint8_t depth)
+{
+	LOGDEBUG1(F("> setSendWindow"), depth);
 
+	if (depth>1 and sendCmd(F("AT+CIPSENDBUF=?"))!=TAG_OK)
+	{
+		LOGWARN(F("AT+CIPSENDBUF not supported"));
+		_sendWindow = 0;
+		return false;
+	}
 
+	_sendWindow = depth;
+	return true;
+}
 
 /*
-* Sends the AT command and stops if any of the TAGS is found.
-* Extract the string enclosed in the passed tags and returns it in the outStr buffer.
-* Returns true if the string is extracted, false if tags are not found of timed out.
+* Send the data of a link with AT+CIPSEND, or with AT+CIPSENDBUF when the
+* send window is enabled. In this case the call returns as soon as the
+* module has received the data, the SEND OK is processed later by poll().
 */
-bool WizFi360Drv::sendCmdGet(const __FlashStringHelper* cmd, const char* startTag, const char* endTag, char* outStr, int outStrLen)
+bool WizFi360Drv::sendLinkData(uint8_t sock, AtCommand* cmd, uint16_t len)
 {
-    int idx;
-	bool ret = false;
+	// <link ID>,<length>
+	CmdArgs<uint8_t, const __FlashStringHelper*, uint16_t> args(sock, F(","), len);
+	setCmdArgs(cmd, &args);
+	cmd->cmdP = true;
 
-	outStr[0] = 0;
+	if (_sendWindow>1 and sock<MAX_SOCK_NUM)
+	{
+		// wait for a free slot in the window
+		if (!waitSendWindow(sock, _sendWindow-1))
+			return false;
 
-	wizfi360EmptyBuf();
+		cmd->cmd = (const char*)F("AT+CIPSENDBUF=");
+		cmd->buffered = true;
 
-	LOGDEBUG(F("----------------------------------------------"));
-	LOGDEBUG1(F(">>"), cmd);
+		// updated by processLine with the values returned by the module
+		_cmdSeq = _sendSeq[sock]+1;
+		_cmdAck = _sendAck[sock];
+	}
+	else
+	{
+		cmd->cmd = (const char*)F("AT+CIPSEND=");
+	}
 
-	// send AT command to WizFi360
-	wizfi360Serial->println(cmd);
+	_txSends++;
+	int ret = runCmd(cmd);
 
-	// read result until the startTag is found
-	idx = readUntil(1000, startTag);
+	// the link may be closed, the next getClientState asks the module
+	if (ret==TAG_ERROR and sock<MAX_SOCK_NUM)
+		_linkState[sock] = LINK_UNKNOWN;
 
-	if(idx==NUMWIZFI360TAGS)
+	if (ret!=(cmd->buffered ? NUMWIZFI360TAGS : TAG_SENDOK))
 	{
-		// clean the buffer to get a clean string
-		ringBuf.init();
+		STATS_ADD(sendFailures, 1);
+		return false;
+	}
 
-		// start tag found, search the endTag
-		idx = readUntil(500, endTag);
+	if (sock<MAX_SOCK_NUM)
+		STATS_ADD(linkTx[sock], len);
 
-		if(idx==NUMWIZFI360TAGS)
-		{
-			// end tag found
-			// copy result to output buffer avoiding overflow
-			ringBuf.getStrN(outStr, strlen(endTag), outStrLen-1);
+	if (!cmd->buffered)
+		return true;
 
-			// read the remaining part of the response
-			readUntil(2000);
+	// the module returns the segment ID of the data and the last one sent
+	_sendSeq[sock] = _cmdSeq;
+	if ((int16_t)(_cmdAck - _sendAck[sock]) > 0)
+		_sendAck[sock] = _cmdAck;
 
-			ret = true;
-		}
-		else
-		{
-			LOGWARN(F("End tag not found"));
-		}
-	}
-	else if(idx>=0 and idx<NUMWIZFI360TAGS)
+	return true;
+}
+
+/*
+* Process the notifications until at most maxPending segments are waiting for
+* their SEND OK on the link.
+* Returns false on timeout or if a segment failed.
+*/
+bool WizFi360Drv::waitSendWindow(uint8_t sock, uint8_t maxPending)
+{
+	unsigned long start = millis();
+
+	while ((uint16_t)(_sendSeq[sock] - _sendAck[sock]) > maxPending)
 	{
-		// the command has returned but no start tag is found
-		LOGDEBUG1(F("No start tag found:"), idx);
+		if (_sendFailed[sock] or millis() - start >= 2000)
+			break;
+		poll();
 	}
-	else
+
+	if (_sendFailed[sock])
 	{
-		// the command has returned but no tag is found
-		LOGWARN(F("No tag found"));
+		LOGERROR1(F("Data packet send error on link"), sock);
+		return false;
 	}
 
-	LOGDEBUG1(F("---------------------------------------------- >"), outStr);
-	LOGDEBUG();
+	if ((uint16_t)(_sendSeq[sock] - _sendAck[sock]) > maxPending)
+	{
+		LOGERROR1(F("Send window timeout on link"), sock);
+		return false;
+	}
 
-	return ret;
+	return true;
 }
 
-bool WizFi360Drv::sendCmdGet(const __FlashStringHelper* cmd, const __FlashStringHelper* startTag, const __FlashStringHelper* endTag, char* outStr, int outStrLen)
+/*
+* Send the buffered data of the links which were not written for
+* SOCK_TX_FLUSH_TIME.
+*/
+void WizFi360Drv::flushIdleData()
 {
-	char _startTag[strlen_P((char*)startTag)+1];
-	strcpy_P(_startTag,  (char*)startTag);
-
-	char _endTag[strlen_P((char*)endTag)+1];
-	strcpy_P(_endTag,  (char*)endTag);
+	if (_txFlushing)
+		return;
 
-	return sendCmdGet(cmd, _startTag, _endTag, outStr, outStrLen);
+	for (uint8_t i=0; i<MAX_SOCK_NUM; i++)
+	{
+		if (_txLen[i]>0 and millis() - _txTime[i] >= SOCK_TX_FLUSH_TIME and !flushData(i))
+		{
+			LOGERROR1(F("Failed to send the buffered data on link"), i);
+		}
+	}
 }
 
 
-/*
-* Sends the AT command and returns the id of the TAG.
-* Return -1 if no tag is found.
-*/
-int WizFi360Drv::sendCmd(const __FlashStringHelper* cmd, int timeout)
+bool WizFi360Drv::startTransparent(const char* host, uint16_t port, uint8_t protMode)
 {
-    wizfi360EmptyBuf();
+	LOGDEBUG2(F("> startTransparent"), host, port);
 
-	LOGDEBUG(F("----------------------------------------------"));
-	LOGDEBUG1(F(">>"), cmd);
+	// transparent transmission is only supported in single connection mode
+	if (sendCmd(F("AT+CIPMUX=0"))!=TAG_OK)
+	{
+		LOGERROR(F("Cannot leave multiple connections mode, close the other links"));
+		return false;
+	}
 
-	wizfi360Serial->println(cmd);
+	int ret = sendCmd(F("AT+CIPMODE=1"));
 
-	int idx = readUntil(timeout);
+	if (ret==TAG_OK)
+	{
+		if (protMode==SSL_MODE)
+		{
+			sendCmd(F("AT+CIPSSLSIZE=4096"));
+			ret = sendCmd(F("AT+CIPSTART=\"SSL\",\""), 5000, host, F("\","), port);
+		}
+		else
+		{
+			ret = sendCmd(F("AT+CIPSTART=\"TCP\",\""), 5000, host, F("\","), port);
+		}
+	}
 
-	LOGDEBUG1(F("---------------------------------------------- >"), idx);
-	LOGDEBUG();
+	// start sending, the data follows the '>' prompt
+	if (ret==TAG_OK and sendCmd(F("AT+CIPSEND"))==TAG_OK and
+		readUntil(1000, ">", false)==NUMWIZFI360TAGS)
+	{
+		_transparent = true;
+		_transparentTx = millis();
+		return true;
+	}
 
-    return idx;
+	LOGERROR(F("Cannot start transparent transmission"));
+	sendCmd(F("AT+CIPMODE=0"));
+	sendCmd(F("AT+CIPCLOSE"), 4000);
+	sendCmd(F("AT+CIPMUX=1"));
+	return false;
 }
 
-
-/*
-* Sends the AT command and returns the id of the TAG.
-* The additional arguments are formatted into the command using sprintf.
-* Return -1 if no tag is found.
-*/
-int WizFi360Drv::sendCmd(const __FlashStringHelper* cmd, int timeout, ...)
+void WizFi360Drv::stopTransparent()
 {
-	char cmdBuf[CMD_BUFFER_SIZE];
+	LOGDEBUG(F("> stopTransparent"));
 
-	va_list args;
-	va_start (args, timeout);
-	vsnprintf_P (cmdBuf, CMD_BUFFER_SIZE, (char*)cmd, args);
-	va_end (args);
-
-	wizfi360EmptyBuf();
+	if (!_transparent)
+		return;
 
-	LOGDEBUG(F("----------------------------------------------"));
-	LOGDEBUG1(F(">>"), cmdBuf);
+	// the escape sequence must be preceded and followed by one second without data
+	wizfi360Serial->flush();
+	unsigned long elapsed = millis() - _transparentTx;
+	if (elapsed < 1000)
+		delay(1000 - elapsed);
 
-	wizfi360Serial->println(cmdBuf);
+	wizfi360Serial->print(F("+++"));
+	delay(1000);
 
-	int idx = readUntil(timeout);
+	// discard the data received before leaving the transparent transmission
+	while (wizfi360Serial->available() > 0)
+		wizfi360Serial->read();
 
-	LOGDEBUG1(F("---------------------------------------------- >"), idx);
-	LOGDEBUG();
+	_transparent = false;
 
-	return idx;
+	sendCmd(F("AT+CIPMODE=0"));
+	sendCmd(F("AT+CIPCLOSE"), 4000);
+	sendCmd(F("AT+CIPMUX=1"));
 }
 
-
-// Read from serial until one of the tags is found
-// Returns:
-//   the index of the tag found in the WIZFI360TAGS array
-//   -1 if no tag was found (timeout)
-int WizFi360Drv::readUntil(unsigned int timeout, const char* tag, bool findTags)
+bool WizFi360Drv::transparentMode()
 {
-	ringBuf.reset();
+	return _transparent;
+}
 
-	char c;
-    unsigned long start = millis();
-	int ret = -1;
+size_t WizFi360Drv::sendTransparent(const uint8_t *data, size_t len)
+{
+	if (!_transparent)
+		return 0;
 
-	while ((millis() - start < timeout) and ret<0)
-	{
-        if(wizfi360Serial->available())
-		{
-            c = (char)wizfi360Serial->read();
-			LOGDEBUG0(c);
-			ringBuf.push(c);
+	_transparentTx = millis();
+	len = wizfi360Serial->write(data, len);
+	STATS_ADD(uartTx, len);
+	STATS_ADD(linkTx[0], len);
+	return len;
+}
 
-			if (tag!=NULL)
-			{
-				if (ringBuf.endsWith(tag))
-				{
-					ret = NUMWIZFI360TAGS;
-					//LOGDEBUG1("xxx");
-				}
-			}
-			if(findTags)
-			{
-				for(int i=0; i<NUMWIZFI360TAGS; i++)
-				{
-					if (ringBuf.endsWith(WIZFI360TAGS[i]))
-					{
-						ret = i;
-						break;
-					}
-				}
-			}
-		}
-    }
+size_t WizFi360Drv::sendTransparent(const DataFragment* frags, uint8_t count)
+{
+	if (!_transparent)
+		return 0;
 
-	if (millis() - start >= timeout)
+	size_t n = 0;
+	for (uint8_t i=0; i<count; i++)
 	{
-		LOGWARN(F(">>> TIMEOUT >>>"));
+		writeFragment((const uint8_t*)frags[i].data, frags[i].len, frags[i].flash);
+		n += frags[i].len;
 	}
 
-    return ret;
+	_transparentTx = millis();
+	STATS_ADD(uartTx, n);
+	STATS_ADD(linkTx[0], n);
+	return n;
 }
 
+int WizFi360Drv::availTransparent()
+{
+	if (!_transparent)
+		return 0;
 
-void WizFi360Drv::wizfi360EmptyBuf(bool warn)
+	return wizfi360Serial->available();
+}
+
+int WizFi360Drv::getTransparent(uint8_t *buf, size_t len)
 {
-    char c;
-	int i=0;
-	while(wizfi360Serial->available() > 0)
+	if (!_transparent)
+		return -1;
+
+	int avail = wizfi360Serial->available();
+	if (len > (size_t)avail)
+		len = avail;
+
+	len = readAvailable(buf, len);
+	STATS_ADD(uartRx, len);
+	STATS_ADD(linkRx[0], len);
+	return len;
+}
+
+int WizFi360Drv::peekTransparent()
+{
+	if (!_transparent)
+		return -1;
+
+	return wizfi360Serial->peek();
+}
+
+
+void WizFi360Drv::getRemoteIpAddress(IPAddress& ip)
+{
+	ip = _remoteIp;
+}
+
+uint16_t WizFi360Drv::getRemotePort()
+{
+	return _remotePort;
+}
+
+uint8_t WizFi360Drv::getFreeSocket()
+{
+	// the module assigns the links of the server in ascending order, so they are allocated in descending order
+	for (int i = MAX_SOCK_NUM - 1; i >= 0; i--)
+	{
+		if (_sockState[i] == NA_STATE)
+			return i;
+	}
+	return SOCK_NOT_AVAIL;
+}
+
+void WizFi360Drv::allocateSocket(uint8_t sock)
+{
+	if (sock < MAX_SOCK_NUM)
+		_sockState[sock] = sock;
+}
+
+void WizFi360Drv::releaseSocket(uint8_t sock)
+{
+	if (sock < MAX_SOCK_NUM)
+		_sockState[sock] = NA_STATE;
+}
+
+bool WizFi360Drv::socketAllocated(uint8_t sock)
+{
+	return sock < MAX_SOCK_NUM and _sockState[sock] != NA_STATE;
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// Utility functions
+////////////////////////////////////////////////////////////////////////////
+
+
+
+/*
+* Sends the AT command and stops if any of the TAGS is found.
+* Extract the string enclosed in the passed tags and returns it in the outStr buffer.
+* Returns true if the string is extracted, false if tags are not found of timed out.
+*/
+bool WizFi360Drv::sendCmdGet(const __FlashStringHelper* cmd, const char* startTag, const char* endTag, char* outStr, int outStrLen)
+{
+	outStr[0] = 0;
+
+	CmdField field = { startTag, endTag, outStr, outStrLen };
+
+	AtCommand getCmd;
+	initCmd(&getCmd, (const char*)cmd, true, 1000);
+	getCmd.fields = &field;
+	getCmd.numFields = 1;
+
+	return runCmd(&getCmd)==NUMWIZFI360TAGS;
+}
+
+bool WizFi360Drv::sendCmdGet(const __FlashStringHelper* cmd, const __FlashStringHelper* startTag, const __FlashStringHelper* endTag, char* outStr, int outStrLen)
+{
+	outStr[0] = 0;
+
+	CmdField field = { (const char*)startTag, (const char*)endTag, outStr, outStrLen };
+
+	AtCommand getCmd;
+	initCmd(&getCmd, (const char*)cmd, true, 1000);
+	getCmd.fields = &field;
+	getCmd.numFields = 1;
+	getCmd.tagsP = true;
+
+	return runCmd(&getCmd)==NUMWIZFI360TAGS;
+}
+
+/*
+* Sends the AT command and extracts several strings from the response.
+* The fields are searched in order and their tags are stored in flash.
+* The output strings must be zeroed, the ones not found are left empty.
+* Returns the number of fields extracted.
+*/
+int WizFi360Drv::sendCmdGetFields(const __FlashStringHelper* cmd, const CmdField* fields, uint8_t numFields)
+{
+	AtCommand getCmd;
+	initCmd(&getCmd, (const char*)cmd, true, 1000);
+	getCmd.fields = fields;
+	getCmd.numFields = numFields;
+	getCmd.tagsP = true;
+
+	runCmd(&getCmd);
+
+	return _cmdField;
+}
+
+
+/*
+* Sends the AT command and returns the id of the TAG.
+* Return -1 if no tag is found.
+*/
+int WizFi360Drv::sendCmd(const __FlashStringHelper* cmd, int timeout)
+{
+	AtCommand atCmd;
+	initCmd(&atCmd, (const char*)cmd, true, timeout);
+
+	return runCmd(&atCmd);
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// AT command queue
+////////////////////////////////////////////////////////////////////////////
+
+bool WizFi360Drv::sendCmdAsync(const __FlashStringHelper* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx)
+{
+	AtCommand atCmd;
+	initCmd(&atCmd, (const char*)cmd, true, timeout);
+	atCmd.callback = callback;
+	atCmd.ctx = ctx;
+
+	return queueCmd(&atCmd);
+}
+
+bool WizFi360Drv::sendCmdAsync(const char* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx)
+{
+	AtCommand atCmd;
+	initCmd(&atCmd, cmd, false, timeout);
+	atCmd.callback = callback;
+	atCmd.ctx = ctx;
+
+	return queueCmd(&atCmd);
+}
+
+bool WizFi360Drv::cmdPending()
+{
+	return _cmdCount>0;
+}
+
+
+/*
+* Advance the command in progress.
+* The command is sent when it reaches the head of the queue, then the
+* response is parsed with the characters already received, without waiting.
+*/
+void WizFi360Drv::poll()
+{
+	// the serial stream carries only data in transparent transmission
+	if (_transparent)
+		return;
+
+	if (_cmdCount==0)
+	{
+		// no command in progress, only the data packets are expected
+		matchTags(false);
+		flushIdleData();
+		return;
+	}
+
+	AtCommand* cmd = &_cmdQueue[_cmdHead];
+
+	if (_cmdStep==CMD_IDLE)
+	{
+		// do not discard the incoming data before sending data
+		if (cmd->data==NULL and cmd->frags==NULL)
+			wizfi360EmptyBuf();
+
+		LOGDEBUG(F("----------------------------------------------"));
+		LOGDEBUG0(F(">> "));
+		size_t n;
+		if (cmd->cmdP)
+		{
+			LOGDEBUG0((const __FlashStringHelper*)cmd->cmd);
+			n = wizfi360Serial->print((const __FlashStringHelper*)cmd->cmd);
+		}
+		else
+		{
+			LOGDEBUG0(cmd->cmd);
+			n = wizfi360Serial->print(cmd->cmd);
+		}
+
+		// the arguments are streamed after the command string
+		if (cmd->printArgs!=NULL)
+		{
+			if (_WIZFILOGLEVEL_>3)
+				cmd->printArgs(&Serial, cmd->args);
+			n += cmd->printArgs(wizfi360Serial, cmd->args);
+		}
+		LOGDEBUG(F(""));
+		n += wizfi360Serial->println();
+		STATS_ADD(uartTx, n);
+#if WIZFI360_STATS
+		_cmdSent = millis();
+#endif
+
+		_cmdField = 0;
+		if (cmd->numFields>0)
+			setCmdStep(CMD_START_TAG, cmd->timeout, cmd->fields[0].startTag, true, cmd->tagsP);
+		else if (cmd->data!=NULL or cmd->frags!=NULL)
+			setCmdStep(CMD_PROMPT, cmd->timeout, ">", false);
+		else
+			setCmdStep(CMD_RESPONSE, cmd->timeout);
+	}
+
+	int idx = matchTags();
+
+	if (idx<0)
+	{
+		if (millis() - _cmdStart < _cmdTimeout)
+			return;
+
+		LOGWARN(F(">>> TIMEOUT >>>"));
+		STATS_ADD(timeouts, 1);
+	}
+
+	switch (_cmdStep)
+	{
+	case CMD_START_TAG:
+		if (idx==NUMWIZFI360TAGS)
+		{
+			// clean the buffer to get a clean string
+			ringBuf.clear();
+
+			// start tag found, search the endTag
+			setCmdStep(CMD_END_TAG, 500, cmd->fields[_cmdField].endTag, true, cmd->tagsP);
+			return;
+		}
+
+		if (idx>=0)
+		{
+			// the command has returned but no start tag is found
+			LOGDEBUG1(F("No start tag found:"), idx);
+
+			// the first fields may have been extracted
+			if (_cmdField>0)
+				idx = NUMWIZFI360TAGS;
+		}
+		else
+		{
+			// the command has returned but no tag is found
+			LOGWARN(F("No tag found"));
+		}
+		completeCmd(idx);
+		return;
+
+	case CMD_END_TAG:
+		if (idx==NUMWIZFI360TAGS)
+		{
+			// end tag found
+			// copy result to output buffer avoiding overflow
+			const CmdField* field = &cmd->fields[_cmdField];
+			unsigned int tagLen = cmd->tagsP ? strlen_P(field->endTag) : strlen(field->endTag);
+			ringBuf.getStrN(field->outStr, tagLen, field->outStrLen-1);
+
+			// search the next field
+			_cmdField++;
+			if (_cmdField<cmd->numFields)
+			{
+				setCmdStep(CMD_START_TAG, cmd->timeout, cmd->fields[_cmdField].startTag, true, cmd->tagsP);
+				return;
+			}
+
+			// read the remaining part of the response
+			_cmdResult = NUMWIZFI360TAGS;
+			setCmdStep(CMD_RESPONSE, 2000);
+			return;
+		}
+
+		LOGWARN(F("End tag not found"));
+		completeCmd(idx);
+		return;
+
+	case CMD_PROMPT:
+		if (idx!=NUMWIZFI360TAGS)
+		{
+			LOGERROR(F("Data packet send error (1)"));
+			completeCmd(-1);
+			return;
+		}
+
+		if (cmd->frags!=NULL)
+		{
+			writeFragments(cmd->frags, cmd->numFrags, cmd->fragsOffset, cmd->dataLen);
+		}
+		else
+		{
+			writeFragment(cmd->data, cmd->dataLen, cmd->dataP);
+		}
+		if (cmd->appendCrLf)
+		{
+			wizfi360Serial->write('\r');
+			wizfi360Serial->write('\n');
+		}
+		STATS_ADD(uartTx, cmd->dataLen + 2*cmd->appendCrLf);
+
+		if (cmd->buffered)
+		{
+			// the segment ID has been parsed by processLine
+			setCmdStep(CMD_RECV, 2000, " bytes\r\n");
+			return;
+		}
+
+		setCmdStep(CMD_SEND_OK, 2000);
+		return;
+
+	case CMD_RECV:
+		if (idx!=NUMWIZFI360TAGS)
+		{
+			LOGERROR(F("Data packet send error (2)"));
+		}
+		completeCmd(idx);
+		return;
+
+	case CMD_SEND_OK:
+		if (idx!=TAG_SENDOK)
+		{
+			LOGERROR(F("Data packet send error (2)"));
+		}
+		completeCmd(idx);
+		return;
+
+	default:
+		// the string extracted by sendCmdGet is reported even if the rest of the response is lost
+		completeCmd(_cmdResult==NUMWIZFI360TAGS ? _cmdResult : idx);
+		return;
+	}
+}
+
+
+void WizFi360Drv::initCmd(AtCommand* cmd, const char* cmdStr, bool cmdP, unsigned int timeout)
+{
+	memset(cmd, 0, sizeof(AtCommand));
+	cmd->cmd = cmdStr;
+	cmd->cmdP = cmdP;
+	cmd->timeout = timeout;
+}
+
+// The serial stream carries only data in transparent transmission,
+// the paths writing AT commands or reading responses stop here
+bool WizFi360Drv::commandMode()
+{
+	if (_transparent)
+	{
+		LOGWARN(F("No AT command in transparent transmission"));
+		return false;
+	}
+	return true;
+}
+
+bool WizFi360Drv::queueCmd(const AtCommand* cmd)
+{
+	if (!commandMode())
+		return false;
+
+	if (_cmdCount>=CMD_QUEUE_SIZE)
+	{
+		LOGWARN(F("AT command queue full"));
+		return false;
+	}
+
+	_cmdQueue[(_cmdHead+_cmdCount) % CMD_QUEUE_SIZE] = *cmd;
+	_cmdCount++;
+	return true;
+}
+
+/*
+* Queue the command and process the queue until it completes.
+* Returns the result passed to the command callback.
+*/
+int WizFi360Drv::runCmd(AtCommand* cmd)
+{
+	if (!commandMode())
+		return -1;
+
+	// the caller's command does not keep the address of the result
+	int result = CMD_PENDING;
+	AtCommand queued = *cmd;
+	queued.callback = storeResult;
+	queued.ctx = &result;
+
+	// make room in the queue
+	while (_cmdCount>=CMD_QUEUE_SIZE)
+		poll();
+
+	if (!queueCmd(&queued))
+		return -1;
+
+	while (result==CMD_PENDING)
+		poll();
+
+	return result;
+}
+
+// Complete the queued commands before accessing directly the serial stream
+void WizFi360Drv::waitCmdQueue()
+{
+	while (_cmdCount>0)
+		poll();
+}
+
+void WizFi360Drv::setCmdStep(uint8_t step, unsigned int timeout, const char* tag, bool findTags, bool tagP)
+{
+	setTags(tag, findTags, tagP);
+
+	_cmdStep = step;
+	_cmdStart = millis();
+	_cmdTimeout = timeout;
+}
+
+void WizFi360Drv::completeCmd(int result)
+{
+	AtCommand* cmd = &_cmdQueue[_cmdHead];
+	WizFi360CmdCallback callback = cmd->callback;
+	void* ctx = cmd->ctx;
+
+	LOGDEBUG1(F("---------------------------------------------- >"), result);
+	LOGDEBUG();
+
+#if WIZFI360_STATS
+	statsCmd(cmd);
+#endif
+
+	// remove the command before calling the callback, it may queue another one
+	_cmdHead = (_cmdHead+1) % CMD_QUEUE_SIZE;
+	_cmdCount--;
+	_cmdStep = CMD_IDLE;
+	_cmdResult = -1;
+
+	if (callback!=NULL)
+		callback(result, ctx);
+}
+
+#if WIZFI360_STATS
+// Count the command completed and its latency by type of command
+void WizFi360Drv::statsCmd(const AtCommand* cmd)
+{
+	// the type is given by the name of the command, AT+<name>[=...]
+	// the bare AT has no name
+	char name[10] = "AT";
+	size_t len = 0;
+	if (cmd->cmd!=NULL)
+		len = cmd->cmdP ? strlen_P(cmd->cmd) : strlen(cmd->cmd);
+	if (len>3)
+	{
+		if (cmd->cmdP)
+			strncpy_P(name, cmd->cmd+3, sizeof(name)-1);
+		else
+			strncpy(name, cmd->cmd+3, sizeof(name)-1);
+		name[sizeof(name)-1] = 0;
+	}
+
+	uint8_t type = STATS_CMD_OTHER;
+	if (strncmp_P(name, PSTR("CIPSEND"), 7)==0)
+		type = STATS_CMD_SEND;
+	else if (strncmp_P(name, PSTR("CIPSTART"), 8)==0)
+		type = STATS_CMD_START;
+	else if (strncmp_P(name, PSTR("CIPCLOSE"), 8)==0)
+		type = STATS_CMD_CLOSE;
+	else if (strncmp_P(name, PSTR("CIPSTATUS"), 9)==0)
+		type = STATS_CMD_STATUS;
+	else if (strncmp_P(name, PSTR("CWJAP"), 5)==0 or strncmp_P(name, PSTR("CWQAP"), 5)==0 or strncmp_P(name, PSTR("CWLAP"), 5)==0)
+		type = STATS_CMD_WIFI;
+
+	// bucket = number of bits of the latency in ms
+	unsigned long latency = millis() - _cmdSent;
+	uint8_t bucket = 0;
+	while (latency>0 and bucket<STATS_LATENCY_BUCKETS-1)
+	{
+		latency >>= 1;
+		bucket++;
+	}
+
+	_stats.cmdCount[type]++;
+	if (_stats.cmdLatency[type][bucket]<0xFFFF)
+		_stats.cmdLatency[type][bucket]++;
+}
+#endif
+
+void WizFi360Drv::storeResult(int tag, void* ctx)
+{
+	*(int*)ctx = tag;
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// Tags
+////////////////////////////////////////////////////////////////////////////
+
+// Read from serial until one of the tags is found
+// Returns:
+//   the index of the tag found in the WIZFI360TAGS array
+//   -1 if no tag was found (timeout)
+int WizFi360Drv::readUntil(unsigned int timeout, const char* tag, bool findTags)
+{
+	if (!commandMode())
+		return -1;
+
+	setTags(tag, findTags);
+
+    unsigned long start = millis();
+	int ret = -1;
+
+	while ((millis() - start < timeout) and ret<0)
+	{
+		ret = matchTags();
+    }
+
+	if (millis() - start >= timeout)
+	{
+		LOGWARN(F(">>> TIMEOUT >>>"));
+		STATS_ADD(timeouts, 1);
+	}
+
+    return ret;
+}
+
+// Select the tags searched by matchTags
+void WizFi360Drv::setTags(const char* tag, bool findTags, bool tagP)
+{
+	ringBuf.clear();
+	respTags.reset();
+
+	_matchRespTags = findTags;
+	_matchUserTag = false;
+	if (tag!=NULL)
+	{
+		// the automaton copies the tag, a temporary copy is enough
+		char tagBuf[TAG_MAX_LENGTH+1];
+		if (tagP)
+		{
+			if (strlen_P(tag)>TAG_MAX_LENGTH)
+			{
+				LOGERROR1(F("Tag too long"), (const __FlashStringHelper*)tag);
+				return;
+			}
+			strcpy_P(tagBuf, tag);
+			tag = tagBuf;
+		}
+
+		_matchUserTag = userTag.build(tag);
+		if (!_matchUserTag)
+		{
+			LOGERROR1(F("Tag too long"), tag);
+		}
+	}
+}
+
+// Read the characters available in the serial buffer until one of the tags is found
+// The payload of the data packets is moved to the receive buffer of their link.
+// If drain is false the payload is left in the serial buffer when the receive buffer is full.
+// Returns:
+//   the index of the tag found in the WIZFI360TAGS array
+//   NUMWIZFI360TAGS if the tag passed to setTags is found
+//   -1 if no tag was found yet
+int WizFi360Drv::matchTags(bool drain)
+{
+	int ret = -1;
+
+	while (ret<0 and wizfi360Serial->available())
+	{
+		if (_ipdLen>0)
+		{
+			if (!readIpdData(drain))
+				break;
+		}
+		else
+		{
+			char c = (char)wizfi360Serial->read();
+			LOGDEBUG0(c);
+			STATS_ADD(uartRx, 1);
+			ret = processChar(c);
+		}
+	}
+
+	return ret;
+}
+
+// Process a character received outside the data packets
+int WizFi360Drv::processChar(char c)
+{
+	int ret = -1;
+
+	// the header of a data packet is not part of the responses
+	if (_ipdField!=IPD_NO_HEADER)
+	{
+		parseIpdHeader(c);
+		return ret;
+	}
+
+	ringBuf.pushOver(c);
+
+	if (_matchUserTag)
+	{
+		if (userTag.step(c)>=0)
+			ret = NUMWIZFI360TAGS;
+	}
+
+	// the response tags are always followed to detect the data packets
+	int idx = respTags.step(c);
+	if (idx==TAG_IPD)
+	{
+		// the line restarts after the payload
+		startIpdHeader();
+		_lineLen = 0;
+		return ret;
+	}
+	else if (idx==TAG_RECVDATA and _recvLink!=NO_SOCKET_AVAIL)
+	{
+		// +CIPRECVDATA:<len>,<data>, the data of the link asked by recvData
+		_ipdField = IPD_LEN;
+		_ipdValue = 0;
+		_ipdDataLen = 0;
+		_ipdLink = _recvLink;
+		_ipdRecvData = true;
+		_lineLen = 0;
+		return ret;
+	}
+	else if (idx>=0 and _matchRespTags)
+	{
+		ret = idx;
+	}
+
+	// assemble the lines, the ones too long to be a notification are skipped
+	if (c=='\n')
+	{
+		if (_lineLen<LINE_BUFFER_SIZE)
+		{
+			_lineBuf[_lineLen] = 0;
+			processLine();
+		}
+		_lineLen = 0;
+	}
+	else if (c!='\r' and _lineLen<LINE_BUFFER_SIZE)
+	{
+		if (_lineLen<LINE_BUFFER_SIZE-1)
+			_lineBuf[_lineLen] = c;
+		_lineLen++;
+	}
+
+	return ret;
+}
+
+// Process a complete line, looking for the notifications
+void WizFi360Drv::processLine()
+{
+	// WIFI CONNECTED
+	// WIFI GOT IP
+	// WIFI DISCONNECT
+	// <link ID>,CONNECT
+	// <link ID>,CLOSED
+	// <link ID>,CONNECT FAIL
+	// <segment ID>,<segment ID sent>        (response of AT+CIPSENDBUF)
+	// <link ID>,<segment ID>,SEND OK
+	// <link ID>,<segment ID>,SEND FAIL
+	char* p = _lineBuf;
+
+	if (*p=='W')
+	{
+		// the network settings change with the connection
+		_netInfoValid = false;
+
+		if (strcmp_P(p, PSTR("WIFI CONNECTED"))==0)
+		{
+			notify(EVENT_WIFI_CONNECTED, NO_SOCKET_AVAIL);
+		}
+		else if (strcmp_P(p, PSTR("WIFI GOT IP"))==0)
+		{
+			_wifiStatus = WL_CONNECTED;
+			notify(EVENT_WIFI_GOT_IP, NO_SOCKET_AVAIL);
+		}
+		else if (strcmp_P(p, PSTR("WIFI DISCONNECT"))==0)
+		{
+			_wifiStatus = WL_DISCONNECTED;
+			notify(EVENT_WIFI_DISCONNECT, NO_SOCKET_AVAIL);
+		}
+		return;
+	}
+
+	if (!isDigit(*p))
+		return;
+
+	uint16_t first = atoi(p);
+	while (isDigit(*p))
+		p++;
+	if (*p!=',')
+		return;
+	p++;
+
+	if (!isDigit(*p))
+	{
+		if (first>=MAX_SOCK_NUM)
+			return;
+
+		if (strcmp_P(p, PSTR("CONNECT"))==0)
+		{
+			_linkState[first] = LINK_CONNECTED;
+			_rxLost[first] = false;
+			_rxPending[first] = false;
+			notify(EVENT_LINK_CONNECT, first);
+		}
+		else if (strcmp_P(p, PSTR("CLOSED"))==0 or strcmp_P(p, PSTR("CONNECT FAIL"))==0)
+		{
+			_linkState[first] = LINK_CLOSED;
+			notify(EVENT_LINK_CLOSED, first);
+		}
+		return;
+	}
+
+	uint16_t seg = atoi(p);
+	while (isDigit(*p))
+		p++;
+
+	if (*p==0)
+	{
+		if (_cmdStep==CMD_PROMPT)
+		{
+			_cmdSeq = first;
+			_cmdAck = seg;
+		}
+		return;
+	}
+
+	if (*p!=',' or first>=MAX_SOCK_NUM)
+		return;
+	p++;
+
+	uint8_t link = first;
+	if (strcmp_P(p, PSTR("SEND OK"))==0)
+	{
+		if ((int16_t)(seg - _sendAck[link]) > 0)
+			_sendAck[link] = seg;
+	}
+	else if (strcmp_P(p, PSTR("SEND FAIL"))==0)
+	{
+		LOGWARN1(F("Segment not sent on link"), link);
+		STATS_ADD(sendFailures, 1);
+		_sendFailed[link] = true;
+		_linkState[link] = LINK_UNKNOWN;
+	}
+}
+
+void WizFi360Drv::notify(uint8_t event, uint8_t link)
+{
+	LOGDEBUG2(F("Notification"), event, link);
+
+	if (_eventCallback!=NULL)
+		_eventCallback(event, link);
+}
+
+void WizFi360Drv::startIpdHeader()
+{
+	_ipdField = IPD_LINK;
+	_ipdValue = 0;
+	_ipdDataLen = 0;
+	_ipdRecvData = false;
+	_remotePort = 0;
+	memset(_remoteIp, 0, sizeof(_remoteIp));
+}
+
+// Parse a character of the +IPD header, the header may be received in several calls
+// format is : +IPD,<ID>,<len>[,"<remote IP>",<remote port>]:<data>
+// In passive receive mode the TCP data stays in the module, the header ends the line:
+//             +IPD,<ID>,<len>[,"<remote IP>",<remote port>]\r\n
+// and the data is returned by AT+CIPRECVDATA with the header:
+//             +CIPRECVDATA:<len>,<data>
+void WizFi360Drv::parseIpdHeader(char c)
+{
+	if (c>='0' and c<='9')
+	{
+		_ipdValue = _ipdValue*10 + (c-'0');
+		return;
+	}
+
+	if (c=='"')
+		return;
+
+	// end of a field
+	switch (_ipdField)
+	{
+	case IPD_LINK: _ipdLink = _ipdValue; break;
+	case IPD_LEN:  _ipdDataLen = _ipdValue; break;
+	case IPD_PORT: _remotePort = _ipdValue; break;
+	default:       _remoteIp[_ipdField-IPD_IP0] = _ipdValue; break;
+	}
+	_ipdValue = 0;
+
+	if (_ipdRecvData)
+	{
+		_ipdField = IPD_NO_HEADER;
+		_ipdRecvData = false;
+		if (c!=',')
+		{
+			LOGWARN(F("Invalid AT+CIPRECVDATA header"));
+			_ipdDataLen = 0;
+			return;
+		}
+
+		_ipdLen = _ipdDataLen;
+		LOGDEBUG2(F("Data received"), _ipdLink, _ipdLen);
+		return;
+	}
+
+	if (c==':' and _ipdField>=IPD_LEN)
+	{
+		_ipdField = IPD_NO_HEADER;
+		_ipdLen = _ipdDataLen;
+
+		LOGDEBUG();
+		LOGDEBUG2(F("Data packet"), _ipdLink, _ipdLen);
+
+		notify(EVENT_LINK_DATA, _ipdLink);
+		return;
+	}
+
+	if (c=='\r' and _ipdField>=IPD_LEN)
+	{
+		// the module keeps the data until recvData asks for it
+		_ipdField = IPD_NO_HEADER;
+		if (_ipdLink<MAX_SOCK_NUM and _ipdDataLen>0)
+			_rxPending[_ipdLink] = true;
+
+		LOGDEBUG();
+		LOGDEBUG2(F("Data pending"), _ipdLink, _ipdDataLen);
+
+		notify(EVENT_LINK_DATA, _ipdLink);
+		return;
+	}
+
+	if ((c!=',' and c!='.') or _ipdField==IPD_PORT)
+	{
+		LOGWARN(F("Invalid data packet header"));
+		_ipdField = IPD_NO_HEADER;
+		return;
+	}
+
+	_ipdField++;
+}
+
+// Move the payload of the data packet in progress to the receive buffer of its link
+// Returns false if the receive buffer is full and drain is false
+bool WizFi360Drv::readIpdData(bool drain)
+{
+	uint8_t chunk[RECV_CHUNK_SIZE];
+
+	if (_recvCallback!=NULL and _ipdLink<MAX_SOCK_NUM)
+	{
+		// hand the payload over by slices, without going through the receive buffer
+		while (_ipdLen>0)
+		{
+			int len = wizfi360Serial->available();
+			if (len<=0)
+				break;
+			if (len>_ipdLen)
+				len = _ipdLen;
+			if (len>RECV_CHUNK_SIZE)
+				len = RECV_CHUNK_SIZE;
+
+			len = readAvailable(chunk, len);
+			_ipdLen -= len;
+			STATS_ADD(uartRx, len);
+			STATS_ADD(linkRx[_ipdLink], len);
+			_recvCallback(_ipdLink, chunk, len);
+		}
+		return true;
+	}
+
+	uint16_t stored = 0;
+	uint16_t dropped = 0;
+
+	while (_ipdLen>0)
+	{
+		int len = wizfi360Serial->available();
+		if (len<=0)
+			break;
+		if (len>_ipdLen)
+			len = _ipdLen;
+		if (len>RECV_CHUNK_SIZE)
+			len = RECV_CHUNK_SIZE;
+
+		// after a gap the rest of the stream is useless
+		bool full = _ipdLink>=MAX_SOCK_NUM or _rxLost[_ipdLink] or _rxBuf[_ipdLink].room()==0;
+		if (full and !drain and _ipdLink<MAX_SOCK_NUM and !_rxLost[_ipdLink])
+			return false;
+		if (!full and (unsigned int)len>_rxBuf[_ipdLink].room())
+			len = _rxBuf[_ipdLink].room();
+
+		len = readAvailable(chunk, len);
+		_ipdLen -= len;
+		STATS_ADD(uartRx, len);
+
+		if (full)
+			dropped += len;
+		else
+			stored += _rxBuf[_ipdLink].push(chunk, len);
+	}
+
+	// the data can't be received again, the link is reported closed
+	// and closed by the next read or connected() of its client
+	if (dropped>0 and _ipdLink<MAX_SOCK_NUM and !_rxLost[_ipdLink])
+	{
+		LOGWARN1(F("Receive buffer full, data dropped on link"), _ipdLink);
+		_rxLost[_ipdLink] = true;
+		_linkState[_ipdLink] = LINK_CLOSED;
+		notify(EVENT_LINK_CLOSED, _ipdLink);
+	}
+	if (stored>0)
+		STATS_ADD(linkRx[_ipdLink], stored);
+
+	return true;
+}
+
+// Close a link which lost received data, the module still has it open
+void WizFi360Drv::closeLostLink(uint8_t sock)
+{
+	LOGWARN1(F("Closing the link after a data loss"), sock);
+	stopClient(sock);
+}
+
+// Read bytes already received, without the timeout of Stream::readBytes
+// which reads the clock for each byte
+size_t WizFi360Drv::readAvailable(uint8_t* buf, size_t len)
+{
+	for (size_t i=0; i<len; i++)
+		buf[i] = wizfi360Serial->read();
+	return len;
+}
+
+// Write data to the module, from RAM or from flash
+void WizFi360Drv::writeFragment(const uint8_t* data, size_t len, bool flash)
+{
+	if (!flash)
+	{
+		wizfi360Serial->write(data, len);
+		return;
+	}
+
+	PGM_P p = reinterpret_cast<PGM_P>(data);
+	for (size_t i=0; i<len; i++)
+	{
+		unsigned char c = pgm_read_byte(p++);
+		wizfi360Serial->write(c);
+	}
+}
+
+// Write len bytes of the fragments, from offset in their concatenation
+void WizFi360Drv::writeFragments(const DataFragment* frags, uint8_t count, size_t offset, size_t len)
+{
+	for (uint8_t i=0; i<count and len>0; i++)
+	{
+		if (offset>=frags[i].len)
+		{
+			offset -= frags[i].len;
+			continue;
+		}
+
+		size_t n = frags[i].len-offset;
+		if (n>len)
+			n = len;
+		writeFragment((const uint8_t*)frags[i].data + offset, n, frags[i].flash);
+		offset = 0;
+		len -= n;
+	}
+}
+
+size_t WizFi360Drv::fragmentsLength(const DataFragment* frags, uint8_t count)
+{
+	size_t len = 0;
+	for (uint8_t i=0; i<count; i++)
+		len += frags[i].len;
+	return len;
+}
+
+void WizFi360Drv::wizfi360EmptyBuf(bool warn)
+{
+    char c;
+	int i=0;
+
+	// the data of the transparent transmission belongs to the client
+	if (_transparent)
+		return;
+
+	while(wizfi360Serial->available() > 0)
     {
+		// the data packets are not dirty characters
+		if (_ipdLen>0)
+		{
+			readIpdData(true);
+			continue;
+		}
+
 		c = wizfi360Serial->read();
 		if (i>0 and warn==true)
 			LOGDEBUG0(c);
 		i++;
+		STATS_ADD(uartRx, 1);
+
+		processChar(c);
 	}
 	if (i>0 and warn==true)
     {
 		LOGDEBUG(F(""));
 		LOGDEBUG1(F("Dirty characters in the serial buffer! >"), i);
+		STATS_ADD(dirtyDiscards, 1);
+		STATS_ADD(dirtyBytes, i);
 	}
 }
 
 
-// copied from Serial::timedRead
-int WizFi360Drv::timedRead()
-{
-  unsigned int _timeout = 1000;
-  int c;
-  long _startMillis = millis();
-  do
-  {
-    c = wizfi360Serial->read();
-    if (c >= 0) return c;
-  } while(millis() - _startMillis < _timeout);
-
-  return -1; // -1 indicates timeout
-}
-
-
-
 WizFi360Drv wizfi360Drv;
@@ -21,9 +21,13 @@ along with The Arduino WizFi360 library.  If not, see
 
 #include "Stream.h"
 #include "IPAddress.h"
+#include <avr/pgmspace.h>
 
 
 #include "RingBuffer.h"
+#include "TagMatcher.h"
+#include "RxBuffer.h"
+#include "CmdArgs.h"
 
 
 
@@ -39,8 +43,23 @@ along with The Arduino WizFi360 library.  If not, see
 // Maximum size of a SSID list
 #define WL_NETWORKS_LIST_MAXNUM	10
 
-// Maximum number of socket
+// Number of links (sockets) handled, up to the 5 links of the module.
+// Every per-link table is sized by it, a lower value saves RAM; 5 makes
+// the fifth link usable at the cost of one more receive buffer.
+//
+// MAX_SOCK_NUM, SOCK_RX_BUFFER_SIZE, SOCK_TX_BUFFER_SIZE, WIZFI360_STATS and
+// SERIAL_RECORDER_SIZE change the size of the library objects. They must be
+// set for the whole build, as compiler flags (e.g. -DMAX_SOCK_NUM=2), never
+// with a #define in the sketch: the library would be compiled with other
+// values than the sketch using its objects. A mismatch fails to link, see
+// WIZFI360_LAYOUT in WizFi360.h.
+#ifndef MAX_SOCK_NUM
 #define	MAX_SOCK_NUM		4
+#endif
+
+#if MAX_SOCK_NUM<1 or MAX_SOCK_NUM>5
+#error "MAX_SOCK_NUM must be between 1 and 5"
+#endif
 
 // Socket not available constant
 #define SOCK_NOT_AVAIL  255
@@ -53,13 +72,214 @@ along with The Arduino WizFi360 library.  If not, see
 #define NO_SOCKET_AVAIL 255
 
 
-// maximum size of AT command
-#define CMD_BUFFER_SIZE 200
+// size of the automaton matching the response tags
+#define TAG_MATCHER_NODES 64
+
+// maximum length of the tag searched by readUntil
+#define TAG_MAX_LENGTH 23
+
+// number of AT commands waiting to be processed by poll()
+#define CMD_QUEUE_SIZE 4
+
+// result of a queued AT command which is not completed yet
+#define CMD_PENDING -2
+
+// maximum length of the notification lines parsed by the driver
+#define LINE_BUFFER_SIZE 24
+
+// maximum time in ms for the module to answer after a power up or a restart
+#ifndef BOOT_TIMEOUT
+#define BOOT_TIMEOUT 5000
+#endif
+
+// interval in ms of the AT+CIPSTATUS checking the link state known from the
+// notifications, 0 to trust the notifications only
+#ifndef LINK_STATE_CHECK_TIME
+#define LINK_STATE_CHECK_TIME 0
+#endif
+
+// time in ms the network information is kept before being asked again
+#ifndef NETWORK_INFO_TTL
+#define NETWORK_INFO_TTL 1000
+#endif
+
+// set to 1 to collect the statistics returned by getStats
+#ifndef WIZFI360_STATS
+#define WIZFI360_STATS 0
+#endif
+
+// size of the slices of data passed to the receive callback
+#define RECV_CHUNK_SIZE 32
+
+// maximum size of the data sent by one AT+CIPSEND, the larger blocks are split
+#define MAX_SEND_SIZE 2048
+
+// size of the buffer coalescing the small writes of each link (build flag, see MAX_SOCK_NUM)
+#ifndef SOCK_TX_BUFFER_SIZE
+#define SOCK_TX_BUFFER_SIZE 64
+#endif
+
+// the buffered data is sent after this idle time in ms
+#ifndef SOCK_TX_FLUSH_TIME
+#define SOCK_TX_FLUSH_TIME 20
+#endif
 
 
 typedef enum eProtMode {TCP_MODE, UDP_MODE, SSL_MODE} tProtMode;
 
 
+/* Tags terminating the response of an AT command */
+typedef enum
+{
+	TAG_OK,
+	TAG_ERROR,
+	TAG_FAIL,
+	TAG_SENDOK,
+	TAG_CONNECT
+} TagsEnum;
+
+
+/*
+ * Called when a queued AT command completes.
+ *
+ * param tag: the tag terminating the response (TagsEnum), -1 on timeout
+ * param ctx: the pointer given when the command was queued
+ */
+typedef void (*WizFi360CmdCallback)(int tag, void* ctx);
+
+/*
+ * Called to reconfigure the serial port connected to the module,
+ * for example Serial1.begin(baud).
+ *
+ * param baud: the new baud rate
+ * param flowControl: true if the RTS/CTS hardware flow control must be enabled
+ */
+typedef void (*WizFi360BaudCallback)(unsigned long baud, bool flowControl);
+
+/*
+ * Called for each access point found by a scan.
+ *
+ * param ssid: the SSID, only valid during the call
+ * param rssi: signal strength in dBm
+ * param encType: encryption type (enum wl_enc_type)
+ * param ctx: the pointer given when the scan was started
+ */
+typedef void (*WizFi360ScanCallback)(const char* ssid, int32_t rssi, uint8_t encType, void* ctx);
+
+
+/* Network settings of the station, read at once by getNetworkInfo */
+typedef struct
+{
+	uint8_t mac[WL_MAC_ADDR_LENGTH];
+	IPAddress localIp;
+	IPAddress gateway;
+	IPAddress netmask;
+	char ssid[WL_SSID_MAX_LENGTH];
+	uint8_t bssid[WL_MAC_ADDR_LENGTH];
+	int32_t rssi;
+} NetworkInfo;
+
+
+/* Fragment of the data written at once by writev, in RAM or in flash */
+typedef struct
+{
+	const void* data;
+	size_t len;
+	bool flash;     // data is a string stored in flash (__FlashStringHelper)
+} DataFragment;
+
+/*
+ * Fragments of RAM data and of flash strings, e.g.
+ *   DataFragment frags[] = { dataFragment(F("HTTP/1.1 200 OK\r\n")), dataFragment(body, len) };
+ */
+inline DataFragment dataFragment(const void* data, size_t len)
+{
+	DataFragment frag = { data, len, false };
+	return frag;
+}
+
+inline DataFragment dataFragment(const char* str)
+{
+	return dataFragment(str, strlen(str));
+}
+
+inline DataFragment dataFragment(const __FlashStringHelper* str)
+{
+	DataFragment frag = { str, strlen_P((PGM_P)str), true };
+	return frag;
+}
+
+
+/* Types of AT commands in the statistics */
+typedef enum
+{
+	STATS_CMD_SEND,       // AT+CIPSEND, AT+CIPSENDBUF
+	STATS_CMD_START,      // AT+CIPSTART
+	STATS_CMD_CLOSE,      // AT+CIPCLOSE
+	STATS_CMD_STATUS,     // AT+CIPSTATUS
+	STATS_CMD_WIFI,       // AT+CWJAP, AT+CWQAP, AT+CWLAP
+	STATS_CMD_OTHER,
+	STATS_CMD_TYPES
+} StatsCmdEnum;
+
+// bucket i of the latency histograms counts the commands completed in
+// [2^(i-1), 2^i) ms, the last one all the longer ones
+#define STATS_LATENCY_BUCKETS 12
+
+/* Driver statistics, collected when WIZFI360_STATS is 1 */
+typedef struct
+{
+	uint32_t cmdCount[STATS_CMD_TYPES];
+	uint16_t cmdLatency[STATS_CMD_TYPES][STATS_LATENCY_BUCKETS];
+	uint32_t uartTx;                 // bytes written to the module
+	uint32_t uartRx;                 // bytes read from the module
+	uint16_t timeouts;               // commands and tags not answered in time
+	uint16_t sendFailures;           // data packets not sent
+	uint16_t dirtyDiscards;          // unexpected data found before a command
+	uint32_t dirtyBytes;
+	uint32_t linkTx[MAX_SOCK_NUM];   // payload bytes sent on each link
+	uint32_t linkRx[MAX_SOCK_NUM];   // payload bytes received on each link
+} WizFi360Stats;
+
+
+/* Unsolicited notifications of the module */
+typedef enum
+{
+	EVENT_WIFI_CONNECTED,     // WIFI CONNECTED
+	EVENT_WIFI_GOT_IP,        // WIFI GOT IP
+	EVENT_WIFI_DISCONNECT,    // WIFI DISCONNECT
+	EVENT_LINK_CONNECT,       // <link ID>,CONNECT
+	EVENT_LINK_CLOSED,        // <link ID>,CLOSED, or received data dropped
+	EVENT_LINK_DATA           // +IPD,<link ID>,...
+} EventsEnum;
+
+/* State of a link known from the notifications */
+typedef enum
+{
+	LINK_UNKNOWN,
+	LINK_CONNECTED,
+	LINK_CLOSED
+} LinkStateEnum;
+
+/*
+ * Called when the module sends a notification.
+ *
+ * param event: the notification (EventsEnum)
+ * param link: the link ID, NO_SOCKET_AVAIL for the WiFi notifications
+ */
+typedef void (*WizFi360EventCallback)(uint8_t event, uint8_t link);
+
+/*
+ * Called by the driver with the data received on a link, as it is read from
+ * the serial interface. The data is only valid during the call.
+ *
+ * param sock: the link the data was received on
+ * param data: pointer to the driver buffer holding the data
+ * param len: number of bytes
+ */
+typedef void (*WizFi360RecvCallback)(uint8_t sock, const uint8_t* data, size_t len);
+
+
 typedef enum {
         WL_FAILURE = -1,
         WL_SUCCESS = 1,
@@ -120,7 +340,9 @@ class WizFi360Drv
 
 public:
 
-    static void wifiDriverInit(Stream *wizfi360Serial);
+    WizFi360Drv();
+
+    void wifiDriverInit(Stream *wizfi360Serial);
 
 
     /* Start Wifi connection with passphrase
@@ -128,24 +350,24 @@ public:
      * param ssid: Pointer to the SSID string.
      * param passphrase: Passphrase. Valid characters in a passphrase must be between ASCII 32-126 (decimal).
      */
-    static bool wifiConnect(const char* ssid, const char* passphrase);
+    bool wifiConnect(const char* ssid, const char* passphrase);
 
 
     /*
 	* Start the Access Point
 	*/
-	static bool wifiStartAP(const char* ssid, const char* pwd, uint8_t channel, uint8_t enc, uint8_t wizfi360Mode);
+	bool wifiStartAP(const char* ssid, const char* pwd, uint8_t channel, uint8_t enc, uint8_t wizfi360Mode);
 
 
     /*
 	 * Set ip configuration disabling dhcp client
 	 */
-    static void config(IPAddress local_ip);
+    void config(IPAddress local_ip);
 
     /*
 	 * Set ip configuration disabling dhcp client
 	 */
-    static void configAP(IPAddress local_ip);
+    void configAP(IPAddress local_ip);
 
 
     /*
@@ -153,30 +375,48 @@ public:
      *
      * return: WL_SUCCESS or WL_FAILURE
      */
-    static int8_t disconnect();
+    int8_t disconnect();
 
     /*
      *
      *
      * return: one value of wl_status_t enum
      */
-    static uint8_t getConnectionStatus();
+    uint8_t getConnectionStatus();
 
     /*
      * Get the interface MAC address.
      *
      * return: pointer to uint8_t array with length WL_MAC_ADDR_LENGTH
      */
-    static uint8_t* getMacAddress();
+    uint8_t* getMacAddress();
+
+    /*
+     * Get all the network settings of the station with AT+CIFSR, AT+CWJAP?
+     * and AT+CIPSTA?. They are kept for the time set by setNetworkInfoTTL,
+     * or until the WiFi connection changes, and the getters below use them.
+     *
+     * param info: copy of the settings, can be NULL
+     * param refresh: ask the module even if the settings are still valid
+     *
+     * return: false if the module did not answer
+     */
+    bool getNetworkInfo(NetworkInfo* info, bool refresh=false);
+
+    /*
+     * Set how long in ms the network settings are kept, 0 to ask the module
+     * each time
+     */
+    void setNetworkInfoTTL(unsigned long ttl);
 
     /*
      * Get the interface IP address.
      *
      * return: copy the ip address value in IPAddress object
      */
-    static void getIpAddress(IPAddress& ip);
+    void getIpAddress(IPAddress& ip);
 
-	static void getIpAddressAP(IPAddress& ip);
+	void getIpAddressAP(IPAddress& ip);
 
     /*
      * Get the interface IP netmask.
@@ -184,7 +424,7 @@ public:
      *
      * return: true if successful
      */
-    static bool getNetmask(IPAddress& mask);
+    bool getNetmask(IPAddress& mask);
 
     /*
      * Get the interface IP gateway.
@@ -192,14 +432,14 @@ public:
      *
      * return: true if successful
      */
-    static bool getGateway(IPAddress& mask);
+    bool getGateway(IPAddress& mask);
 
     /*
      * Return the current SSID associated with the network
      *
      * return: ssid string
      */
-    static char* getCurrentSSID();
+    char* getCurrentSSID();
 
     /*
      * Return the current BSSID associated with the network.
@@ -207,7 +447,7 @@ public:
      *
      * return: pointer to uint8_t array with length WL_MAC_ADDR_LENGTH
      */
-    static uint8_t* getCurrentBSSID();
+    uint8_t* getCurrentBSSID();
 
     /*
      * Return the current RSSI /Received Signal Strength in dBm)
@@ -215,14 +455,27 @@ public:
      *
      * return: signed value
      */
-    static int32_t getCurrentRSSI();
+    int32_t getCurrentRSSI();
 
     /*
      * Get the networks available
      *
      * return: Number of discovered networks
      */
-    static uint8_t getScanNetworks();
+    uint8_t getScanNetworks();
+
+    /*
+     * Scan the networks and pass each access point to the callback as soon as
+     * it is parsed, without storing them.
+     * The module is asked with AT+CWLAPOPT to sort them by RSSI and to send
+     * only the fields used.
+     *
+     * param maxResults: only the maxResults strongest access points are
+     *        passed, 0 for all. Ignored if the module cannot sort them.
+     *
+     * return: number of access points passed to the callback, -1 on error
+     */
+    int scanNetworks(WizFi360ScanCallback callback, void* ctx, uint8_t maxResults);
 
 	/*
      * Return the SSID discovered during the network scan.
@@ -231,7 +484,7 @@ public:
 	 *
      * return: ssid string of the specified item on the networks scanned list
      */
-    static char* getSSIDNetoworks(uint8_t networkItem);
+    char* getSSIDNetoworks(uint8_t networkItem);
 
     /*
      * Return the RSSI of the networks discovered during the scanNetworks
@@ -240,7 +493,7 @@ public:
 	 *
      * return: signed value of RSSI of the specified item on the networks scanned list
      */
-    static int32_t getRSSINetoworks(uint8_t networkItem);
+    int32_t getRSSINetoworks(uint8_t networkItem);
 
     /*
      * Return the encryption type of the networks discovered during the scanNetworks
@@ -249,13 +502,13 @@ public:
 	 *
      * return: encryption type (enum wl_enc_type) of the specified item on the networks scanned list
      */
-    static uint8_t getEncTypeNetowrks(uint8_t networkItem);
+    uint8_t getEncTypeNetowrks(uint8_t networkItem);
 
 
     /*
      * Get the firmware version
      */
-    static char* getFwVersion();
+    char* getFwVersion();
 
 
 	////////////////////////////////////////////////////////////////////////////
@@ -263,70 +516,401 @@ public:
 	////////////////////////////////////////////////////////////////////////////
 
 
-    static bool startServer(uint16_t port, uint8_t sock);
-    static bool startClient(const char* host, uint16_t port, uint8_t sock, uint8_t protMode);
-    static void stopClient(uint8_t sock);
-    static uint8_t getServerState(uint8_t sock);
-    static uint8_t getClientState(uint8_t sock);
-    static bool getData(uint8_t connId, uint8_t *data, bool peek, bool* connClose);
-    static int getDataBuf(uint8_t connId, uint8_t *buf, uint16_t bufSize);
-    static bool sendData(uint8_t sock, const uint8_t *data, uint16_t len);
-    static bool sendData(uint8_t sock, const __FlashStringHelper *data, uint16_t len, bool appendCrLf=false);
-	static bool sendDataUdp(uint8_t sock, const char* host, uint16_t port, const uint8_t *data, uint16_t len);
-    static uint16_t availData(uint8_t connId);
+    bool startServer(uint16_t port, uint8_t sock);
+    bool startClient(const char* host, uint16_t port, uint8_t sock, uint8_t protMode);
+    void stopClient(uint8_t sock);
+    uint8_t getServerState(uint8_t sock);
+    uint8_t getClientState(uint8_t sock);
+    bool getData(uint8_t connId, uint8_t *data, bool peek, bool* connClose);
+    int getDataBuf(uint8_t connId, uint8_t *buf, uint16_t bufSize);
+    bool sendData(uint8_t sock, const uint8_t *data, size_t len);
+    bool sendData(uint8_t sock, const __FlashStringHelper *data, size_t len, bool appendCrLf=false);
+	bool sendDataUdp(uint8_t sock, const char* host, uint16_t port, const uint8_t *data, size_t len);
 
+    /*
+     * Send the fragments with a single AT+CIPSEND of their total length.
+     * Larger than MAX_SEND_SIZE on a TCP link, each AT+CIPSEND but the last
+     * one carries MAX_SEND_SIZE bytes across the fragments; a UDP datagram
+     * cannot be larger.
+     */
+    bool sendData(uint8_t sock, const DataFragment* frags, uint8_t count);
+	bool sendDataUdp(uint8_t sock, const char* host, uint16_t port, const DataFragment* frags, uint8_t count);
 
-	static bool ping(const char *host);
-    static void reset();
+    /*
+     * Buffer the data written on a link to send it with as few AT+CIPSEND as
+     * possible. The buffer is sent when it is full, by flushData, before
+     * reading the link, or by poll() after SOCK_TX_FLUSH_TIME without write.
+     *
+     * return: false if sending the buffer failed
+     */
+    bool writeData(uint8_t sock, const uint8_t *data, size_t len);
+    bool writeData(uint8_t sock, const __FlashStringHelper *data, size_t len, bool appendCrLf=false);
+    bool writeData(uint8_t sock, const DataFragment* frags, uint8_t count);
+    bool flushData(uint8_t sock);
 
-    static void getRemoteIpAddress(IPAddress& ip);
-    static uint16_t getRemotePort();
+    /*
+     * Return the number of AT+CIPSEND issued for the buffered data and the
+     * number of writes which were merged in a previous one.
+     */
+    void getTxCounters(unsigned long* sends, unsigned long* saved);
+
+    /*
+     * Set the number of TCP segments which can be sent on a link before
+     * waiting for their SEND OK, using AT+CIPSENDBUF.
+     * A depth of 0 or 1 sends each segment with AT+CIPSEND.
+     *
+     * return: false if the firmware does not support AT+CIPSENDBUF
+     */
+    bool setSendWindow(uint8_t depth);
+
+
+	////////////////////////////////////////////////////////////////////////////
+	// Transparent transmission
+	////////////////////////////////////////////////////////////////////////////
+
+    /*
+     * Open a single connection in transparent transmission mode.
+     * The data is then exchanged on the serial interface without AT framing
+     * and no AT command can be sent until stopTransparent is called.
+     * It fails if other links are open.
+     */
+    bool startTransparent(const char* host, uint16_t port, uint8_t protMode);
+    void stopTransparent();
+    bool transparentMode();
+    size_t sendTransparent(const uint8_t *data, size_t len);
+    size_t sendTransparent(const DataFragment* frags, uint8_t count);
+    int availTransparent();
+    int getTransparent(uint8_t *buf, size_t len);
+    int peekTransparent();
+    uint16_t availData(uint8_t connId);
+
+    /*
+     * Set the function receiving the data of all the links instead of the
+     * receive buffers, NULL to go back to the receive buffers.
+     * With a callback the module sends the TCP data as it arrives, without
+     * it the module keeps the data until the receive buffer has room for it
+     * (AT+CIPRECVMODE).
+     * The callback is called from poll() and the other driver functions, it
+     * must not call the library.
+     */
+    void setRecvCallback(WizFi360RecvCallback callback);
+
+    /*
+     * Set the function called with the notifications of the module, wherever
+     * they are received. Like the receive callback it must not call the library.
+     */
+    void setEventCallback(WizFi360EventCallback callback);
+
+    /*
+     * Return a link with received data which was not opened by startClient,
+     * NO_SOCKET_AVAIL if none
+     */
+    uint8_t getServerLink();
+
+
+	bool ping(const char *host);
+    void reset();
+
+    /*
+     * Return the time in ms taken by the last wifiDriverInit, from the first
+     * AT command to the end of the configuration of the module.
+     */
+    unsigned long getBootTime();
+
+    /*
+     * Copy the statistics of the driver.
+     *
+     * return: false if they are not collected, see WIZFI360_STATS
+     */
+    bool getStats(WizFi360Stats* stats);
+    void resetStats();
+
+    /*
+     * Change the baud rate of the module with AT+UART_CUR, then call
+     * setHostBaud to change the one of the serial port and check the link.
+     * If the module does not answer, both sides go back to currentBaud.
+     * The setting is not saved, the module restarts at its default baud rate.
+     *
+     * return: false if the baud rate was not changed
+     */
+    bool setBaudRate(unsigned long baud, unsigned long currentBaud, WizFi360BaudCallback setHostBaud, bool flowControl);
+
+
+	////////////////////////////////////////////////////////////////////////////
+	// Asynchronous AT commands
+	////////////////////////////////////////////////////////////////////////////
+
+	/*
+	 * Queue an AT command, the response is processed by poll().
+	 * The command string must stay valid until the callback is called.
+	 *
+	 * return: false if the queue is full
+	 */
+	bool sendCmdAsync(const __FlashStringHelper* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx);
+	bool sendCmdAsync(const char* cmd, unsigned int timeout, WizFi360CmdCallback callback, void* ctx);
+
+	/*
+	 * Send the queued AT commands and process their response without blocking.
+	 */
+	void poll();
+
+	/*
+	 * Return true if some AT commands are queued or waiting for the response
+	 */
+	bool cmdPending();
+
+    void getRemoteIpAddress(IPAddress& ip);
+    uint16_t getRemotePort();
+
+    /*
+     * Allocation of the links to the clients, servers and UDP sockets
+     */
+    uint8_t getFreeSocket();
+    void allocateSocket(uint8_t sock);
+    void releaseSocket(uint8_t sock);
+    bool socketAllocated(uint8_t sock);
 
 
 ////////////////////////////////////////////////////////////////////////////////
 
 private:
-	static Stream *wizfi360Serial;
 
-	static long _bufPos;
-	static uint8_t _connId;
+	// string of a response extracted between two tags
+	struct CmdField
+	{
+		const char* startTag;
+		const char* endTag;
+		char* outStr;
+		int outStrLen;
+	};
+
+	// AT command processed by the command queue
+	struct AtCommand
+	{
+		const char* cmd;            // command string
+		bool cmdP;                  // the command string is stored in flash
+		unsigned int timeout;
+
+		const void* args;           // CmdArgs printed after the command string
+		size_t (*printArgs)(Print* out, const void* args);
+
+		const CmdField* fields;     // strings extracted from the response, in order
+		uint8_t numFields;
+		bool tagsP;                 // the tags of the fields are stored in flash
+
+		const uint8_t* data;        // data written after the '>' prompt
+		uint16_t dataLen;
+		bool dataP;                 // the data is stored in flash
+		bool appendCrLf;
+		bool buffered;              // sent with AT+CIPSENDBUF
+		const DataFragment* frags;  // data written in pieces, instead of data
+		uint8_t numFrags;
+		size_t fragsOffset;         // start of the dataLen bytes in the fragments
+
+		WizFi360CmdCallback callback;
+		void* ctx;
+	};
+
+	// steps of the command in progress
+	typedef enum
+	{
+		CMD_IDLE,
+		CMD_RESPONSE,
+		CMD_START_TAG,
+		CMD_END_TAG,
+		CMD_PROMPT,
+		CMD_SEND_OK,
+		CMD_RECV
+	} CmdStep;
+
+	// fields of the header +IPD,<ID>,<len>[,"<remote IP>",<remote port>]:
+	typedef enum
+	{
+		IPD_LINK,
+		IPD_LEN,
+		IPD_IP0,
+		IPD_IP1,
+		IPD_IP2,
+		IPD_IP3,
+		IPD_PORT,
+		IPD_NO_HEADER
+	} IpdFieldEnum;
+
+	Stream *wizfi360Serial;
+
+	// +IPD data packet in progress
+	uint8_t _ipdLink;
+	uint16_t _ipdLen;    // bytes of the payload not yet received
+
+	// +IPD header in progress, parsed as the characters arrive
+	uint8_t _ipdField;      // IpdFieldEnum, IPD_NO_HEADER if none
+	uint16_t _ipdValue;     // value of the field in progress
+	uint16_t _ipdDataLen;   // <len> field
+	bool _ipdRecvData;      // header of the response of AT+CIPRECVDATA
+	uint8_t _recvLink;      // link of the AT+CIPRECVDATA in progress
+
+	// data received on each link
+	RxBuffer _rxBuf[MAX_SOCK_NUM];
+
+	// receives the data instead of _rxBuf when set
+	WizFi360RecvCallback _recvCallback;
+
+	// state updated by the notifications
+	WizFi360EventCallback _eventCallback;
+	uint8_t _wifiStatus;                  // WL_NO_SHIELD if unknown
+	uint8_t _linkState[MAX_SOCK_NUM];     // LinkStateEnum
+	unsigned long _linkCheck[MAX_SOCK_NUM];   // time of the last AT+CIPSTATUS
+	bool _rxLost[MAX_SOCK_NUM];           // received data dropped, the link is closed
+	bool _rxPending[MAX_SOCK_NUM];        // data kept by the module in passive receive mode
+
+	// links opened by startClient, the other ones are accepted by the server
+	bool _linkClient[MAX_SOCK_NUM];
+
+	// segments sent with AT+CIPSENDBUF
+	uint8_t _sendWindow;
+	uint16_t _sendSeq[MAX_SOCK_NUM];     // last segment sent
+	uint16_t _sendAck[MAX_SOCK_NUM];     // last segment acknowledged
+	bool _sendFailed[MAX_SOCK_NUM];
+	uint16_t _cmdSeq;
+	uint16_t _cmdAck;
+
+	// data written but not sent yet
+	uint8_t _txBuf[MAX_SOCK_NUM][SOCK_TX_BUFFER_SIZE];
+	uint16_t _txLen[MAX_SOCK_NUM];
+	unsigned long _txTime[MAX_SOCK_NUM];   // time of the last write
+	bool _txFlushing;
+	unsigned long _txSends;
+	unsigned long _txSaved;
+
+	// transparent transmission in progress
+	bool _transparent;
+	unsigned long _transparentTx;   // time of the last data sent
+
+	// current line, to parse the notifications
+	char _lineBuf[LINE_BUFFER_SIZE];
+	uint8_t _lineLen;
+
+	unsigned long _bootTime;
+
+#if WIZFI360_STATS
+	WizFi360Stats _stats;
+	unsigned long _cmdSent;   // time the command in progress was sent
+#endif
+
+	uint16_t _remotePort;
+	uint8_t  _remoteIp[WL_IPV4_LENGTH];
 
-	static uint16_t _remotePort;
-	static uint8_t  _remoteIp[WL_IPV4_LENGTH];
+	int16_t _sockState[MAX_SOCK_NUM];   // NA_STATE if the link is free
 
 
 	// firmware version string
-	static char 	fwVersion[WL_FW_VER_LENGTH];
+	char 	fwVersion[WL_FW_VER_LENGTH];
 
-	// settings of requested network
+	// result of the last getScanNetworks, shared by the instances
+	// the linker keeps it only if the sketch uses this scan API
+	static uint8_t 	_networkNum;
 	static char 	_networkSsid[WL_NETWORKS_LIST_MAXNUM][WL_SSID_MAX_LENGTH];
 	static int32_t 	_networkRssi[WL_NETWORKS_LIST_MAXNUM];
 	static uint8_t 	_networkEncr[WL_NETWORKS_LIST_MAXNUM];
 
 
 	// settings of current selected network
-	static char 	_ssid[WL_SSID_MAX_LENGTH];
-	static uint8_t 	_bssid[WL_MAC_ADDR_LENGTH];
-	static uint8_t 	_mac[WL_MAC_ADDR_LENGTH];
-	static uint8_t  _localIp[WL_IPV4_LENGTH];
-
+	NetworkInfo _netInfo;
+	bool _netInfoValid;
+	unsigned long _netInfoTime;
+	unsigned long _netInfoTTL;
+	uint8_t  _localIp[WL_IPV4_LENGTH];
 
-	// the ring buffer is used to search the tags in the stream
-	static RingBuffer ringBuf;
 
+	// the ring buffer keeps the last characters read to extract the strings
+	RingBuffer<32> ringBuf;
 
-	//static int sendCmd(const char* cmd, int timeout=1000);
-	static int sendCmd(const __FlashStringHelper* cmd, int timeout=1000);
-	static int sendCmd(const __FlashStringHelper* cmd, int timeout, ...);
+	// the tag matchers search the response tags and the caller's tag in the stream
+	TagMatcher<TAG_MATCHER_NODES> respTags;
+	TagMatcher<TAG_MAX_LENGTH+1> userTag;
+	bool _matchRespTags;
+	bool _matchUserTag;
 
-	static bool sendCmdGet(const __FlashStringHelper* cmd, const char* startTag, const char* endTag, char* outStr, int outStrLen);
-	static bool sendCmdGet(const __FlashStringHelper* cmd, const __FlashStringHelper* startTag, const __FlashStringHelper* endTag, char* outStr, int outStrLen);
+	// queue of the AT commands, the first one is in progress
+	AtCommand _cmdQueue[CMD_QUEUE_SIZE];
+	uint8_t _cmdHead;
+	uint8_t _cmdCount;
+	uint8_t _cmdStep;
+	int _cmdResult;
+	unsigned long _cmdStart;
+	unsigned int _cmdTimeout;
+	uint8_t _cmdField;        // field of the response in progress
 
-	static int readUntil(unsigned int timeout, const char* tag=NULL, bool findTags=true);
 
-	static void wizfi360EmptyBuf(bool warn=true);
+	//static int sendCmd(const char* cmd, int timeout=1000);
+	int sendCmd(const __FlashStringHelper* cmd, int timeout=1000);
 
-	static int timedRead();
+	/*
+	* Sends the AT command followed by the arguments and returns the id of the TAG.
+	* The arguments are printed one after the other, without separator.
+	* Return -1 if no tag is found.
+	*/
+	template<typename... Args>
+	int sendCmd(const __FlashStringHelper* cmd, int timeout, Args... args)
+	{
+		CmdArgs<Args...> cmdArgs(args...);
+
+		AtCommand atCmd;
+		initCmd(&atCmd, (const char*)cmd, true, timeout);
+		setCmdArgs(&atCmd, &cmdArgs);
+
+		return runCmd(&atCmd);
+	}
+
+	template<typename... Args>
+	static void setCmdArgs(AtCommand* cmd, const CmdArgs<Args...>* args)
+	{
+		cmd->args = args;
+		cmd->printArgs = printCmdArgs<Args...>;
+	}
+
+	bool sendCmdGet(const __FlashStringHelper* cmd, const char* startTag, const char* endTag, char* outStr, int outStrLen);
+	bool sendCmdGet(const __FlashStringHelper* cmd, const __FlashStringHelper* startTag, const __FlashStringHelper* endTag, char* outStr, int outStrLen);
+	int sendCmdGetFields(const __FlashStringHelper* cmd, const CmdField* fields, uint8_t numFields);
+
+	void initCmd(AtCommand* cmd, const char* cmdStr, bool cmdP, unsigned int timeout);
+	bool queueCmd(const AtCommand* cmd);
+	bool commandMode();
+	int runCmd(AtCommand* cmd);
+	void waitCmdQueue();
+	void setCmdStep(uint8_t step, unsigned int timeout, const char* tag=NULL, bool findTags=true, bool tagP=false);
+	void completeCmd(int result);
+	static void storeResult(int tag, void* ctx);
+
+	int readUntil(unsigned int timeout, const char* tag=NULL, bool findTags=true);
+	void setTags(const char* tag, bool findTags, bool tagP=false);
+	int matchTags(bool drain=true);
+	int processChar(char c);
+	void processLine();
+	void notify(uint8_t event, uint8_t link);
+#if WIZFI360_STATS
+	void statsCmd(const AtCommand* cmd);
+#endif
+	bool sendLinkData(uint8_t sock, AtCommand* cmd, uint16_t len);
+	bool waitSendWindow(uint8_t sock, uint8_t maxPending);
+	void flushIdleData();
+	bool waitReady(bool banner);
+	void updateNetworkInfo();
+	static void storeNetwork(const char* ssid, int32_t rssi, uint8_t encType, void* ctx);
+	static void parseMacAddress(char* str, uint8_t* mac);
+	bool switchBaudRate(unsigned long baud, WizFi360BaudCallback setHostBaud, bool flowControl, bool rollback=false);
+	void startIpdHeader();
+	void parseIpdHeader(char c);
+	bool readIpdData(bool drain);
+	void recvData(uint8_t sock);
+	void setRecvMode();
+	void closeLostLink(uint8_t sock);
+
+	void wizfi360EmptyBuf(bool warn=true);
+	size_t readAvailable(uint8_t* buf, size_t len);
+	void writeFragment(const uint8_t* data, size_t len, bool flash);
+	void writeFragments(const DataFragment* frags, uint8_t count, size_t offset, size_t len);
+	static size_t fragmentsLength(const DataFragment* frags, uint8_t count);
 
 
 	friend class WiFiServer;